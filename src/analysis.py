@@ -1,12 +1,12 @@
 import sys
+import mysymnmf
 from kmeans import kmeans
 from symnmf import read_data, symNMF
-from sklearn.metrics import silhouette_score
 
 def main():
     """
         Compare SymNMF to Kmeans from HW1.
-        Prints the silhouette_score from the sklearn.metrics for SymNMF and Kmeans.
+        Prints the silhouette score (mysymnmf.silhouette_c) for SymNMF and Kmeans.
         A higher score indicates better-defined clusters.
     """
     
@@ -21,11 +21,11 @@ def main():
     n, d = x.shape
     
     symNMF_labels = symNMF(x=x, k=k, n=n)
-    sym_silhouette_score = silhouette_score(x, symNMF_labels)
-    print(f"nmf: {sym_silhouette_score}")
-    
     kmeans_labels = kmeans(input_data=file_name, k=k, n=n, d=d)
-    kmeans_silhouette_score = silhouette_score(x, kmeans_labels)
+
+    # Both labelings are scored in one pass over the pairwise distances.
+    sym_silhouette_score, kmeans_silhouette_score = mysymnmf.silhouette_c([symNMF_labels, kmeans_labels], x=x)
+    print(f"nmf: {sym_silhouette_score}")
     print(f"kmeans: {kmeans_silhouette_score}")
 
 
@@ -0,0 +1,248 @@
+import argparse
+import json
+import os
+import resource
+import subprocess
+import sys
+import tempfile
+import time
+import numpy as np
+import mysymnmf as symnmf
+
+
+DEFAULT_SIZES = [1000, 2000, 5000, 10000, 20000, 50000, 100000]
+DEFAULT_DIMS = [2, 8, 32]
+
+
+def make_blobs(n, d, k, seed):
+    """
+    Draw n points in d dimensions around k Gaussian centres.
+    :param n: number of points
+    :param d: number of dimensions
+    :param k: number of blobs
+    :param seed: seed of the NumPy generator, so every version benchmarks the same data
+    :return: the points as an n×d NumPy array
+    """
+    rng = np.random.default_rng(seed)
+    centres = rng.uniform(-10.0, 10.0, size=(k, d))
+    members = rng.integers(0, k, size=n)
+    return centres[members] + rng.normal(0.0, 1.0, size=(n, d))
+
+
+def write_data(file_name, x):
+    """
+    Write points in the comma separated text format that read_data and the symnmf binary read.
+    """
+    np.savetxt(file_name, x, fmt="%.4f", delimiter=",")
+
+
+def version():
+    """
+    Name the benchmarked version of the code, as git describe does; 'unknown' outside a git tree.
+    """
+    try:
+        return subprocess.run(["git", "describe", "--always", "--dirty"], capture_output=True, text=True,
+                              cwd=os.path.dirname(os.path.abspath(__file__)), check=True).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return "unknown"
+
+
+def reset_peak_rss():
+    """
+    Start a new peak resident set size, as Linux allows through /proc/self/clear_refs.
+    :return: True if the peak was reset, False if peak_rss_kb will still report the peak of the whole process
+    """
+    try:
+        with open("/proc/self/clear_refs", "w") as f:
+            f.write("5")
+        return True
+    except OSError:
+        return False
+
+
+def peak_rss_kb():
+    """
+    Read the peak resident set size in kB since the last reset_peak_rss, or since the process started.
+    """
+    try:
+        with open("/proc/self/status") as f:
+            for line in f:
+                if line.startswith("VmHWM:"):
+                    return int(line.split()[1])
+    except OSError:
+        pass
+    return resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+
+
+class Recorder:
+    """
+    Times stages of one (n, d) configuration and prints a JSON record for each.
+    """
+
+    def __init__(self, n, d, tag):
+        self.n = n
+        self.d = d
+        self.tag = tag
+
+    def run(self, stage, function, work, unit, repeat=1):
+        """
+        Time function() and print its record.
+        :param stage: name of the stage
+        :param function: the call to time; its result is returned
+        :param work: amount of work one call does, in units of unit
+        :param unit: what throughput counts, per second
+        :param repeat: calls to time; the fastest is reported
+        """
+        best, result = None, None
+        symnmf.allocation_stats(reset=True)
+        scope = "stage" if reset_peak_rss() else "process"
+        for _ in range(repeat):
+            start = time.perf_counter()
+            result = function()
+            seconds = time.perf_counter() - start
+            best = seconds if best is None else min(best, seconds)
+        count, allocated = symnmf.allocation_stats()
+        self.emit(stage, best, work / best if best > 0 else None, unit, peak_rss_kb(), scope, count // repeat,
+                  allocated // repeat)
+        return result
+
+    def emit(self, stage, seconds, throughput, unit, peak_kb, peak_scope, allocations, allocated_bytes):
+        record = {"version": self.tag, "n": self.n, "d": self.d, "stage": stage, "seconds": seconds,
+                  "throughput": throughput, "unit": unit, "peak_rss_kb": peak_kb, "peak_rss_scope": peak_scope,
+                  "allocations": allocations, "allocated_bytes": allocated_bytes}
+        print(json.dumps(record), flush=True)
+
+
+def bench_config(n, d, args):
+    """
+    Benchmark every stage for one dataset; runs in its own process, so even a peak_rss_kb of scope 'process'
+    belongs to this dataset alone.
+    """
+    recorder = Recorder(n, d, args.tag)
+    x = make_blobs(n, d, args.k, args.seed)
+    sparse = n > args.dense_limit
+    knn = args.knn if sparse else 0
+    entries = n * args.knn if sparse else n * n
+
+    with tempfile.TemporaryDirectory() as directory:
+        file_name = os.path.join(directory, "data.txt")
+        write_data(file_name, x)
+        x = recorder.run("readData", lambda: symnmf.load_data_c(file_name), n * d, "values/s")
+
+    goal = "symknn" if sparse else "sym"
+    recorder.run(goal, lambda: symnmf.symnmf_c(goal, x, threads=args.threads, knn=knn), entries, "entries/s",
+                 args.repeat)
+    recorder.run("ddg", lambda: symnmf.symnmf_c("ddg", x, threads=args.threads, knn=knn), entries, "entries/s",
+                 args.repeat)
+    W = recorder.run("norm", lambda: symnmf.symnmf_c("norm", x, threads=args.threads, knn=knn), entries,
+                     "entries/s", args.repeat)
+
+    # One converge_h_c call per iteration times each update_H on its own.
+    mean = (W[2].sum() if sparse else W.sum()) / (n * n)
+    H = np.random.default_rng(args.seed).uniform(0.0, 2.0 * np.sqrt(mean / args.k), size=(n, args.k))
+    for iteration in range(args.iterations):
+        H = recorder.run(f"update_H[{iteration}]", lambda: symnmf.converge_h_c(H, W, 0.0, 1, args.threads),
+                         entries * args.k, "entries/s")
+
+    # With no iterations and the default stopping test converge_h_c only marshals its arguments and
+    # result, and never reads W: it is viewed in place, unless its layout forces a copy.
+    recorder.run("marshal", lambda: symnmf.converge_h_c(H, W, 0.0, 0, args.threads), n * args.k, "values/s",
+                 args.repeat)
+    if not sparse:
+        W_fortran = np.asfortranarray(W)
+        recorder.run("marshal_copy", lambda: symnmf.converge_h_c(H, W_fortran, 0.0, 0, args.threads),
+                     entries, "values/s", args.repeat)
+
+
+def run_configs(args):
+    """
+    Run every (n, d) configuration in a child process and collect the records it prints.
+    :return: the records, and the number of children that failed, as by crashing or running out of memory
+    """
+    records, failures = [], 0
+    for n in args.sizes:
+        for d in args.dims:
+            command = [sys.executable, os.path.abspath(__file__), "--child", str(n), str(d),
+                       "--k", str(args.k), "--seed", str(args.seed), "--threads", str(args.threads),
+                       "--iterations", str(args.iterations), "--repeat", str(args.repeat),
+                       "--knn", str(args.knn), "--dense-limit", str(args.dense_limit), "--tag", args.tag]
+            child = subprocess.run(command, capture_output=True, text=True)
+            # The C code prints progress of its own; only records are JSON objects.
+            lines = [line for line in child.stdout.splitlines() if line.startswith("{")]
+            records.extend(json.loads(line) for line in lines)
+            for line in lines:
+                print(line, flush=True)
+            if child.returncode != 0:
+                failures += 1
+                print(f"n={n} d={d} failed with status {child.returncode}: {child.stderr.strip()}", file=sys.stderr)
+    return records, failures
+
+
+def compare(records, baseline_file, tolerance, configs):
+    """
+    Compare records with a baseline written by an earlier run.
+    :param configs: the (n, d) pairs of this run; baseline stages of other configurations are not compared
+    :return: the number of stages slower than the baseline by more than the tolerance (a fraction), plus the
+             number of baseline stages of these configurations that have no record
+    """
+    with open(baseline_file) as f:
+        baseline = {(r["n"], r["d"], r["stage"]): r
+                    for r in (json.loads(line) for line in f if line.startswith("{"))}
+    measured = {(record["n"], record["d"], record["stage"]) for record in records}
+    regressions = 0
+    for key, old in sorted(baseline.items()):
+        if (key[0], key[1]) in configs and key not in measured:
+            regressions += 1
+            print(f"regression: n={key[0]} d={key[1]} {key[2]} ({old['version']}) has no record", file=sys.stderr)
+    for record in records:
+        old = baseline.get((record["n"], record["d"], record["stage"]))
+        if old is None or not old["seconds"]:
+            continue
+        ratio = record["seconds"] / old["seconds"]
+        if ratio > 1.0 + tolerance:
+            regressions += 1
+            print(f"regression: n={record['n']} d={record['d']} {record['stage']} {old['seconds']:.6f}s "
+                  f"({old['version']}) -> {record['seconds']:.6f}s ({record['version']}), x{ratio:.2f}",
+                  file=sys.stderr)
+    return regressions
+
+
+def main():
+    """
+        Benchmark the C extension on synthetic Gaussian blobs.
+        Prints one JSON record per line for every (n, d, stage): seconds, throughput, peak RSS and the
+        number and bytes of matrix allocations. The peak RSS is that of the stage where Linux can reset it
+        (peak_rss_scope 'stage'), and otherwise that of the process so far ('process'). Exits with status 1
+        if a configuration fails, or, with --baseline, if any stage got slower than the baseline records by
+        more than --tolerance or has no record.
+    """
+    parser = argparse.ArgumentParser(description=main.__doc__)
+    parser.add_argument("--sizes", type=int, nargs="+", default=DEFAULT_SIZES)
+    parser.add_argument("--dims", type=int, nargs="+", default=DEFAULT_DIMS)
+    parser.add_argument("--k", type=int, default=4)
+    parser.add_argument("--seed", type=int, default=0)
+    parser.add_argument("--threads", type=int, default=0)
+    parser.add_argument("--iterations", type=int, default=5, help="update_H iterations to time")
+    parser.add_argument("--repeat", type=int, default=1, help="calls per stage; the fastest is reported")
+    parser.add_argument("--knn", type=int, default=16, help="neighbours of the sparse graph above --dense-limit")
+    parser.add_argument("--dense-limit", type=int, default=10000, help="largest n run on the dense W")
+    parser.add_argument("--baseline", help="JSON lines of an earlier run to compare with")
+    parser.add_argument("--tolerance", type=float, default=0.2, help="allowed slowdown, as a fraction")
+    parser.add_argument("--tag", default=None, help="version recorded with the results; def = git describe")
+    parser.add_argument("--child", type=int, nargs=2, metavar=("N", "D"), help=argparse.SUPPRESS)
+    args = parser.parse_args()
+    args.tag = args.tag or version()
+
+    if args.child:
+        bench_config(args.child[0], args.child[1], args)
+        return
+
+    records, failures = run_configs(args)
+    configs = {(n, d) for n in args.sizes for d in args.dims}
+    regressions = compare(records, args.baseline, args.tolerance, configs) if args.baseline else 0
+    if failures > 0 or regressions > 0:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,500 @@
+import argparse
+import glob
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+import numpy as np
+import mysymnmf as symnmf
+from symnmf import read_data
+
+
+DATA_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "data")
+K_VALUES = [1, 2, 3, 5, 8, 12, 16, 17]
+MAX_POINTS = 500  # Leading points of each input that are checked, so the NumPy references stay small.
+SOLVERS = ["multiplicative", "adaptive", "nesterov", "gradient"]
+ITERATIONS = 20   # Iterations of the solver runs; enough for the paths to diverge if they differ.
+
+
+class Checker:
+    """
+    Collects the outcome of every check and prints one line for each.
+    """
+
+    def __init__(self):
+        self.failures = 0
+
+    def expect(self, name, passed, detail=""):
+        """
+        Record one check.
+        :param name: what was checked
+        :param passed: whether it held
+        :param detail: printed with the outcome, such as the largest difference
+        """
+        print(f"{'ok  ' if passed else 'FAIL'} {name} {detail}".rstrip(), flush=True)
+        self.failures += 0 if passed else 1
+
+    def close(self, name, actual, expected, tolerance):
+        """
+        Check that two arrays agree to a relative tolerance; 0 asks for identical bits.
+        """
+        actual = np.asarray(actual, dtype=np.float64)
+        expected = np.asarray(expected, dtype=np.float64)
+        if actual.shape != expected.shape:
+            self.expect(name, False, f"shape {actual.shape} != {expected.shape}")
+            return
+        if tolerance == 0:
+            self.expect(name, np.array_equal(actual, expected), "(bit-identical)")
+            return
+        scale = max(float(np.max(np.abs(expected), initial=0.0)), 1.0)
+        error = float(np.max(np.abs(actual - expected), initial=0.0)) / scale
+        self.expect(name, error <= tolerance, f"(relative error {error:.2e})")
+
+    def raises(self, name, function, error=ValueError):
+        """
+        Check that function() raises error, and does not crash or succeed.
+        """
+        try:
+            function()
+        except error:
+            self.expect(name, True)
+            return
+        except Exception as other:
+            self.expect(name, False, f"raised {type(other).__name__}")
+            return
+        self.expect(name, False, "did not raise")
+
+
+def inputs():
+    """
+    Load the first MAX_POINTS points of every data/input_*.txt, in order.
+    """
+    return [(os.path.basename(name), read_data(name)[:MAX_POINTS])
+            for name in sorted(glob.glob(os.path.join(DATA_DIR, "input_*.txt")))]
+
+
+def reference_norm(x):
+    """
+    The similarity matrix, degrees and normalized similarity matrix of x, computed directly in NumPy.
+    """
+    squared = ((x[:, None, :] - x[None, :, :]) ** 2).sum(axis=2)
+    A = np.exp(-squared / 2.0)
+    np.fill_diagonal(A, 0.0)
+    degrees = A.sum(axis=1)
+    scale = 1.0 / np.sqrt(degrees)
+    return A, degrees, A * scale[:, None] * scale[None, :]
+
+
+def reference_update(H, W, beta=0.5):
+    """
+    One multiplicative update of H, with the denominator formed as H * transpose(H) * H.
+    """
+    return H * (1.0 - beta + beta * (W @ H) / ((H @ H.T) @ H))
+
+
+def reference_silhouette(x, labels):
+    """
+    The mean silhouette score of a labeling, computed directly in NumPy.
+    """
+    distances = np.sqrt(((x[:, None, :] - x[None, :, :]) ** 2).sum(axis=2))
+    clusters = np.unique(labels)
+    scores = np.zeros(len(x))
+    for i in range(len(x)):
+        own = labels == labels[i]
+        if own.sum() < 2:
+            continue
+        a = distances[i, own].sum() / (own.sum() - 1)
+        b = min(distances[i, labels == c].mean() for c in clusters if c != labels[i])
+        scores[i] = (b - a) / max(a, b)
+    return scores.mean()
+
+
+def initial_h(W, k, seed):
+    """
+    The initial H of symnmf.py: uniform in [0, 2 * sqrt(mean(W) / k)].
+    """
+    return np.random.default_rng(seed).uniform(0.0, 2.0 * np.sqrt(np.mean(W) / k), size=(W.shape[0], k))
+
+
+def kernel_results():
+    """
+    Results of the paths whose kernels are chosen at runtime, for every input and every k in
+    K_VALUES; a child process computes them under the environment being compared.
+    """
+    results = {}
+    for name, x in inputs():
+        W = np.asarray(symnmf.symnmf_c("norm", x))
+        W_single = np.asarray(symnmf.symnmf_c("norm", x, precision="single"))
+        for k in K_VALUES:
+            if k >= len(x):
+                continue
+            H = initial_h(W, k, 0)
+            results[f"{name} k={k} update"] = np.asarray(symnmf.converge_h_c(H, W, 0.0, 1))
+            results[f"{name} k={k} single update"] = np.asarray(symnmf.converge_h_c(H, W_single, 0.0, 1))
+            for solver in SOLVERS:
+                H_solver = symnmf.converge_h_c(H, W, 1e-4, ITERATIONS, solver=solver, stop="labels")
+                results[f"{name} k={k} {solver}"] = np.asarray(H_solver)
+            H_knn = symnmf.symnmf_c("symnmf", x, k=k, knn=10, iter=ITERATIONS)[1]
+            results[f"{name} k={k} knn"] = np.asarray(H_knn)
+            H_implicit = symnmf.symnmf_c("symnmf", x, k=k, weights="implicit", iter=1)[1]
+            results[f"{name} k={k} implicit update"] = np.asarray(H_implicit)
+    return results
+
+
+def child_results(environment):
+    """
+    Run kernel_results in a child process with extra environment variables.
+    """
+    with tempfile.TemporaryDirectory() as directory:
+        file_name = os.path.join(directory, "results.npz")
+        subprocess.run([sys.executable, os.path.abspath(__file__), "--child", file_name],
+                       env=dict(os.environ, **environment), check=True)
+        with np.load(file_name) as data:
+            return {key: data[key] for key in data.files}
+
+
+def check_reference(checker):
+    """
+    sym, ddg and norm against NumPy, for both storage precisions (user-003, 004, 014 and 024),
+    one update against its formula (user-005 and 006), and one update with an implicit W against one
+    with the stored W (user-016).
+    """
+    for name, x in inputs():
+        A, degrees, W = reference_norm(x)
+        checker.close(f"{name} sym", symnmf.symnmf_c("sym", x), A, 1e-12)
+        checker.close(f"{name} ddg", symnmf.symnmf_c("ddg", x), degrees, 1e-12)
+        checker.close(f"{name} norm", symnmf.symnmf_c("norm", x), W, 1e-12)
+        checker.close(f"{name} single sym", symnmf.symnmf_c("sym", x, precision="single"), A, 1e-6)
+        checker.close(f"{name} single norm", symnmf.symnmf_c("norm", x, precision="single"), W, 1e-6)
+        for k in K_VALUES:
+            if k >= len(x):
+                continue
+            H = initial_h(W, k, 0)
+            checker.close(f"{name} k={k} update", symnmf.converge_h_c(H, W, 0.0, 1), reference_update(H, W), 1e-12)
+            checker.close(f"{name} k={k} implicit update",
+                          symnmf.symnmf_c("symnmf", x, k=k, weights="implicit", iter=1)[1],
+                          symnmf.symnmf_c("symnmf", x, k=k, iter=1)[1], 1e-10)
+
+
+def check_offset(checker):
+    """
+    Data far from the origin: sym and norm, in memory, out of core and with an implicit W, stay accurate, and
+    non-finite coordinates are rejected (user-003).
+    """
+    name, x = inputs()[0]
+    x = x[:200]
+    for offset in (1e5, 1e7):
+        shifted = x + offset
+        A, degrees, W = reference_norm(shifted)
+        checker.close(f"{name} +{offset:g} sym", symnmf.symnmf_c("sym", shifted), A, 1e-8)
+        checker.close(f"{name} +{offset:g} norm", symnmf.symnmf_c("norm", shifted), W, 1e-8)
+        with tempfile.TemporaryDirectory() as directory:
+            scratch = os.path.join(directory, "scratch.bin")
+            checker.close(f"{name} +{offset:g} scratch norm",
+                          np.array(symnmf.symnmf_c("norm", shifted, scratch=scratch)), W, 1e-8)
+        checker.close(f"{name} +{offset:g} implicit update",
+                      symnmf.symnmf_c("symnmf", shifted, k=3, weights="implicit", iter=1)[1],
+                      symnmf.symnmf_c("symnmf", x, k=3, weights="implicit", iter=1)[1], 1e-8)
+        labels = symnmf.kmeans_c(x, 3)
+        checker.close(f"{name} +{offset:g} silhouette", symnmf.silhouette_c(labels, x=shifted),
+                      reference_silhouette(shifted, labels), 1e-8)
+
+    for value in (np.nan, np.inf):
+        broken = x.copy()
+        broken[3, 0] = value
+        checker.raises(f"{name} {value} coordinate in sym", lambda: symnmf.symnmf_c("sym", broken))
+        checker.raises(f"{name} {value} coordinate in kmeans", lambda: symnmf.kmeans_c(broken, 3))
+
+
+def check_kernels(checker):
+    """
+    Every runtime-selected kernel against the default one: the GEMM kernels agree to rounding
+    (user-005), the small-k kernels and any thread count give identical bits (user-025, 004).
+    """
+    default = child_results({})
+    variants = [("SYMNMF_SMALL_K=off", {"SYMNMF_SMALL_K": "off"}, 0),
+                ("SYMNMF_NUM_THREADS=3", {"SYMNMF_NUM_THREADS": "3", "OMP_WAIT_POLICY": "passive"}, 0),
+                ("SYMNMF_GEMM_KERNEL=scalar", {"SYMNMF_GEMM_KERNEL": "scalar"}, 1e-10),
+                ("SYMNMF_GEMM_KERNEL=avx2", {"SYMNMF_GEMM_KERNEL": "avx2"}, 1e-10)]
+    for label, environment, tolerance in variants:
+        results = child_results(environment)
+        for key, expected in default.items():
+            # Iterated solvers amplify rounding differences; only single updates are compared to rounding.
+            if tolerance == 0 or key.endswith("update"):
+                checker.close(f"{key} {label}", results[key], expected, tolerance)
+
+
+def check_extend(checker):
+    """
+    extend_symnmf_c against the same matrices computed from scratch for all the points (user-019).
+    """
+    for name, x in inputs():
+        n = len(x) // 2
+        A = symnmf.symnmf_c("sym", x[:n])
+        D = symnmf.symnmf_c("ddg", x[:n])
+        H = symnmf.symnmf_c("symnmf", x[:n], k=2, iter=ITERATIONS)[1]
+        X_all, A_all, D_all, _ = symnmf.extend_symnmf_c(x[:n], A, D, H, x[n:], iter=ITERATIONS)
+        checker.close(f"{name} extend X", X_all, x, 0)
+        checker.close(f"{name} extend A", A_all, symnmf.symnmf_c("sym", x), 1e-12)
+        checker.close(f"{name} extend D", D_all, symnmf.symnmf_c("ddg", x), 1e-12)
+
+        # Grown in place in three steps, the arrays passed in keep their contents; extending an older
+        # model again must not overwrite the storage of the newer one (user-019).
+        steps = [n // 2, n, len(x)]
+        m = n // 4
+        model = symnmf.extend_symnmf_c(x[:m], symnmf.symnmf_c("sym", x[:m]), symnmf.symnmf_c("ddg", x[:m]), H[:m],
+                                       x[m:steps[0]], iter=ITERATIONS, capacity=len(x))
+        first = [np.array(m) for m in model]
+        grown = model
+        for start, end in zip(steps, steps[1:]):
+            grown = symnmf.extend_symnmf_c(*grown, x[start:end], iter=ITERATIONS)
+        checker.close(f"{name} extend in place A", grown[1], symnmf.symnmf_c("sym", x), 1e-12)
+        checker.close(f"{name} extend in place D", grown[2], symnmf.symnmf_c("ddg", x), 1e-12)
+        checker.expect(f"{name} extend in place shares storage", np.shares_memory(grown[1], model[1]))
+        checker.expect(f"{name} extend in place keeps the old arrays",
+                       all(np.array_equal(old, new) for old, new in zip(first, model)))
+        branch = symnmf.extend_symnmf_c(*model, x[steps[1]:], iter=ITERATIONS)
+        checker.expect(f"{name} extend an older model copies", not np.shares_memory(branch[1], grown[1]))
+        checker.close(f"{name} extend in place after a branch", grown[1], symnmf.symnmf_c("sym", x), 1e-12)
+
+    shapes = [("H without columns", lambda X, A, D, H: (X, A, D, H[:, :0])),
+              ("H rows", lambda X, A, D, H: (X, A, D, H[:-1])),
+              ("A rows", lambda X, A, D, H: (X, A[:-1], D, H))]
+    name, x = inputs()[0]
+    A = symnmf.symnmf_c("sym", x[:20])
+    D = symnmf.symnmf_c("ddg", x[:20])
+    H = np.ones((20, 2))
+    for label, change in shapes:
+        arguments = change(x[:20], A, D, H)
+        checker.raises(f"extend rejects {label}", lambda: symnmf.extend_symnmf_c(*arguments, x[20:30]))
+
+
+def check_kmeans(checker):
+    """
+    kmeans_c at convergence labels every point with its nearest centroid, its k-means++ seeding is reproducible
+    for a seed and any thread count, and k outside 1..n is rejected (user-021).
+    """
+    for name, x in inputs():
+        for k in (1, 3, 5):
+            labels = np.asarray(symnmf.kmeans_c(x, k, iter=1000, eps=0.0))
+            centroids = np.array([x[labels == c].mean(axis=0) for c in range(k) if np.any(labels == c)])
+            used = np.array([c for c in range(k) if np.any(labels == c)])
+            squared = ((x[:, None, :] - centroids[None, :, :]) ** 2).sum(axis=2)
+            nearest = used[squared.argmin(axis=1)]
+            checker.expect(f"{name} kmeans k={k} nearest centroid", np.array_equal(nearest, labels))
+
+        labels = symnmf.kmeans_c(x, 3, seed=7)
+        checker.close(f"{name} kmeans same seed", symnmf.kmeans_c(x, 3, seed=7), labels, 0)
+        checker.close(f"{name} kmeans threads=3", symnmf.kmeans_c(x, 3, seed=7, threads=3), labels, 0)
+        checker.raises(f"{name} kmeans k=0", lambda: symnmf.kmeans_c(x, 0))
+        checker.raises(f"{name} kmeans k>n", lambda: symnmf.kmeans_c(x, len(x) + 1))
+
+
+def check_silhouette(checker):
+    """
+    silhouette_c against NumPy, from x, from A and from distances (user-022).
+    """
+    for name, x in inputs():
+        labels = symnmf.kmeans_c(x, 3, 300, 1e-4, 0, 0)
+        expected = reference_silhouette(x, labels)
+        A = symnmf.symnmf_c("sym", x)
+        distances = np.sqrt(((x[:, None, :] - x[None, :, :]) ** 2).sum(axis=2))
+        checker.close(f"{name} silhouette x", symnmf.silhouette_c(labels, x=x), expected, 1e-12)
+        checker.close(f"{name} silhouette distances", symnmf.silhouette_c(labels, distances=distances), expected,
+                      1e-12)
+        # A holds exp(-d^2 / 2), so d = sqrt(-2 ln A) loses digits for far apart points.
+        checker.close(f"{name} silhouette A", symnmf.silhouette_c(labels, x=x, A=A), expected, 1e-6)
+
+    x = inputs()[0][1]
+    checker.raises("silhouette 0-d labels", lambda: symnmf.silhouette_c(np.array(3), x=x))
+    checker.raises("silhouette 3-d labels", lambda: symnmf.silhouette_c(np.zeros((1, 1, len(x)), dtype=int), x=x))
+
+
+def matrix_file(file_name, rows, cols, stride, values):
+    """
+    Write a binary matrix file with any header, valid or not; see MatrixFileHeader in dataio.h.
+    """
+    header = struct.pack("=8sIIIII", b"SYMNMF01", 0x01020304, 1, rows, cols, stride)
+    with open(file_name, "wb") as f:
+        f.write(header.ljust(64, b"\0") + np.asarray(values, dtype=np.float64).tobytes())
+
+
+def check_radius(checker):
+    """
+    The radius graph, built from the distances above the diagonal, links exactly the points within radius and
+    keeps every row sorted by column, and a graph without edges is rejected by symnmf (user-008).
+    """
+    for name, x in inputs():
+        squared = ((x[:, None, :] - x[None, :, :]) ** 2).sum(axis=2)
+        radius = float(np.sqrt(np.median(squared)))
+        row_start, col_index, values = symnmf.symnmf_c("sym", x, radius=radius)
+        A = np.zeros((len(x), len(x)))
+        rows = np.repeat(np.arange(len(x)), np.diff(row_start))
+        A[rows, col_index] = values
+        expected = np.where(squared <= radius * radius, reference_norm(x)[0], 0.0)
+        checker.close(f"{name} radius graph", A, expected, 1e-12)
+        sorted_rows = all(np.all(np.diff(col_index[row_start[i]:row_start[i + 1]]) > 0) for i in range(len(x)))
+        checker.expect(f"{name} radius graph rows sorted", sorted_rows)
+        for solver in ("multiplicative", "nesterov"):
+            checker.raises(f"{name} {solver} on a radius graph without edges",
+                           lambda: symnmf.symnmf_c("symnmf", x, k=2, radius=1e-3, solver=solver))
+
+
+def check_files(checker):
+    """
+    Binary matrix files: a round trip, and headers that do not describe the file are rejected (user-010).
+    """
+    with tempfile.TemporaryDirectory() as directory:
+        file_name = os.path.join(directory, "matrix.bin")
+        for name, x in inputs():
+            symnmf.save_matrix_c(file_name, x)
+            checker.close(f"{name} matrix file", symnmf.load_matrix_c(file_name), x, 0)
+
+        # rows * stride * 8 is 2^64 + 64: it wraps to the 64 bytes the file holds.
+        matrix_file(file_name, 2147352580, 1, 1073807362, np.zeros(8))
+        checker.raises("matrix file size overflow", lambda: symnmf.load_matrix_c(file_name))
+        matrix_file(file_name, 0, 1, 1, np.zeros(8))
+        checker.raises("matrix file without rows", lambda: symnmf.load_matrix_c(file_name))
+        matrix_file(file_name, 1, 0, 1, np.zeros(8))
+        checker.raises("matrix file without columns", lambda: symnmf.load_matrix_c(file_name))
+        matrix_file(file_name, 2, 4, 3, np.zeros(8))
+        checker.raises("matrix file stride below columns", lambda: symnmf.load_matrix_c(file_name))
+        matrix_file(file_name, 3, 3, 3, np.zeros(8))
+        checker.raises("matrix file shorter than its header says", lambda: symnmf.load_matrix_c(file_name))
+
+
+def check_parse(checker):
+    """
+    The symnmf binary and load_data_c read numbers of any length, in the middle of a line and at the very end
+    of the file (user-009, 020).
+    """
+    binary = os.path.join(os.path.dirname(os.path.abspath(__file__)), "symnmf")
+    name, x = inputs()[0]
+    x = x[:20]
+    with tempfile.TemporaryDirectory() as directory:
+        short_file = os.path.join(directory, "short.txt")
+        long_file = os.path.join(directory, "long.txt")
+        np.savetxt(short_file, x, fmt="%.17g", delimiter=",")
+        # 80 decimals print these doubles exactly, in tokens longer than the 64 characters copied onto the stack.
+        with open(long_file, "w") as f:
+            f.write("\n".join(",".join(f"{value:.80f}" for value in row) for row in x))
+        outputs = [subprocess.run([binary, "sym", file_name], capture_output=True, text=True).stdout
+                   for file_name in (short_file, long_file)]
+        loaded = [symnmf.load_data_c(file_name) for file_name in (short_file, long_file)]
+        with open(long_file, "a") as f:
+            f.write("\n1,2,x")
+        checker.raises(f"{name} load_data_c malformed file", lambda: symnmf.load_data_c(long_file))
+    checker.expect(f"{name} long numbers", outputs[0] == outputs[1] and "Error" not in outputs[1])
+    checker.close(f"{name} load_data_c", loaded[0], x, 0)
+    checker.close(f"{name} load_data_c long numbers", loaded[1], x, 0)
+
+
+def check_scratch(checker):
+    """
+    The dense goals computed out of core into a scratch file equal the ones computed in memory (user-015).
+    """
+    with tempfile.TemporaryDirectory() as directory:
+        file_name = os.path.join(directory, "scratch.bin")
+        for name, x in inputs():
+            for goal in ("sym", "ddg", "norm"):
+                expected = symnmf.symnmf_c(goal, x)
+                actual = np.array(symnmf.symnmf_c(goal, x, scratch=file_name))
+                checker.close(f"{name} {goal} scratch", actual, expected, 0)
+
+
+def check_restarts(checker):
+    """
+    symnmf_c('symnmf') always returns (labels, H, scores), and only the kept restart reports its convergence
+    (user-018).
+    """
+    name, x = inputs()[0]
+    W = reference_norm(x)[2]
+    for restarts in (1, 3):
+        labels, H, scores = symnmf.symnmf_c("symnmf", x, k=3, restarts=restarts)
+        checker.expect(f"{name} restarts={restarts} scores", len(scores) == restarts and len(labels) == len(x))
+        checker.close(f"{name} restarts={restarts} best score", min(scores), np.sum((W - H @ H.T) ** 2), 1e-9)
+
+    script = "import sys, numpy as np, mysymnmf; mysymnmf.symnmf_c('symnmf', np.load(sys.argv[1]), k=3, restarts=3)"
+    with tempfile.TemporaryDirectory() as directory:
+        file_name = os.path.join(directory, "x.npy")
+        np.save(file_name, x)
+        output = subprocess.run([sys.executable, "-c", script, file_name], capture_output=True, text=True,
+                                env=dict(os.environ, PYTHONPATH=os.path.dirname(os.path.abspath(__file__)))).stdout
+    checker.expect(f"{name} restarts=3 reports convergence once", output.count("Converged after") == 1)
+
+
+def check_async(checker):
+    """
+    converge_h_async works on copies of H and W, and cancelled() means the iterations were stopped (user-012).
+    """
+    name, x = inputs()[0]
+    W = np.array(symnmf.symnmf_c("norm", x))
+    H = initial_h(W, 3, 0)
+    expected = symnmf.converge_h_c(H, W, 0.0, 200)
+
+    future = symnmf.converge_h_async(H, W, 0.0, 200)
+    W[:] = 0.0
+    H[:] = 1.0
+    checker.close(f"{name} async on copies", future.result(), expected, 0)
+    checker.expect("async cancel after the result", not future.cancel() and not future.cancelled())
+
+    future = symnmf.converge_h_async(initial_h(W + 1.0, 3, 0), W + 1.0, 0.0, 10 ** 9)
+    cancelled = future.cancel()
+    future.result()
+    checker.expect("async cancel while running", cancelled and future.cancelled())
+
+
+def check_trajectories(checker):
+    """
+    Trajectories hold the objective of every iterate and leave H unchanged; the adaptive solvers stay finite
+    (user-017).
+    """
+    name, x = inputs()[0]
+    W = np.array(symnmf.symnmf_c("norm", x))
+    for solver in SOLVERS:
+        for seed in range(3):
+            H = initial_h(W, 5, seed)
+            result, objectives = symnmf.converge_h_c(H, W, 0.0, ITERATIONS, solver=solver, trajectory=True)
+            label = f"{name} {solver} seed={seed}"
+            checker.close(f"{label} trajectory H", result, symnmf.converge_h_c(H, W, 0.0, ITERATIONS, solver=solver), 0)
+            checker.expect(f"{label} trajectory finite", np.all(np.isfinite(objectives)) and np.all(np.isfinite(result)))
+            for t in (0, 1, ITERATIONS // 2, ITERATIONS - 1):
+                iterate = np.array(symnmf.converge_h_c(H, W, 0.0, t, solver=solver))
+                expected = np.sum((W - iterate @ iterate.T) ** 2)
+                checker.close(f"{label} objective {t}", objectives[t], expected, 1e-9)
+
+
+def main():
+    """
+        Check the C extension against reference results on the inputs in data/.
+        Prints one line per check and exits with status 1 if any failed.
+    """
+    parser = argparse.ArgumentParser(description=main.__doc__)
+    parser.add_argument("--child", help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.child:
+        np.savez(args.child, **kernel_results())
+        return
+
+    checker = Checker()
+    check_reference(checker)
+    check_offset(checker)
+    check_kernels(checker)
+    check_extend(checker)
+    check_kmeans(checker)
+    check_silhouette(checker)
+    check_radius(checker)
+    check_files(checker)
+    check_parse(checker)
+    check_scratch(checker)
+    check_restarts(checker)
+    check_async(checker)
+    check_trajectories(checker)
+    print(f"{checker.failures} failed", flush=True)
+    sys.exit(1 if checker.failures else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,482 @@
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L /* For mmap. */
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dataio.h"
+
+/* This C code loads data points from text files. The file is memory-mapped
+ * and parsed in a single pass: values may be separated by commas and/or
+ * whitespace, lines may be of any length, and the number of rows is
+ * discovered while parsing.
+ * It also reads and writes binary matrix files (see MatrixFileHeader),
+ * which hold a Matrix exactly as it is laid out in memory, and creates
+ * file-backed scratch matrices in that layout for out-of-core work. */
+
+#define PARSE_MAX_DIGITS 15 /* Significant digits that fit exactly in a double. */
+#define PARSE_MAX_TOKEN 64  /* Longest number the strtod fallback copies onto the stack. */
+
+static const double powersOfTen[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+/* Function to tell whether a character separates values. */
+static int isSeparator(char c) {
+    return c == ',' || c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+
+/* 
+ * Function to parse one number 
+ * Numbers with at most 15 significant digits and a small exponent are
+ * converted exactly with a single multiplication or division by a power
+ * of ten; anything else goes through strtod. strtod reads the number in
+ * place when a character follows it in the buffer, since that character
+ * cannot continue it; a number that ends the buffer is copied first, as
+ * strtod needs a terminator.
+ * Input: text - start of the number
+ *        end - end of the buffer
+ *        value - output
+ * Return: const char* - first character after the number, or NULL if the
+ *         text is not a number
+ */
+static const char *parseDouble(const char *text, const char *end, double *value) {
+    const char *p = text;
+    char token[PARSE_MAX_TOKEN + 1];
+    char *copy;
+    size_t length;
+    double mantissa = 0.0;
+    int negative = 0, digits = 0, significant = 0, scale = 0, exponent = 0, expNegative = 0;
+    int exact = 1;
+
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+
+    for (; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+        if (significant < PARSE_MAX_DIGITS) {
+            mantissa = mantissa * 10 + (*p - '0');
+            significant += (mantissa != 0.0);
+        }
+        else {
+            exact = 0;
+        }
+    }
+
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+            if (significant < PARSE_MAX_DIGITS) {
+                mantissa = mantissa * 10 + (*p - '0');
+                significant += (mantissa != 0.0);
+                scale--;
+            }
+            else {
+                exact = 0;
+            }
+        }
+    }
+
+    if (digits == 0) {
+        return NULL;
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (p < end && (*p == '-' || *p == '+')) {
+            expNegative = (*p == '-');
+            p++;
+        }
+        if (p >= end || *p < '0' || *p > '9') {
+            return NULL;
+        }
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            exponent = (exponent < 10000) ? exponent * 10 + (*p - '0') : exponent;
+        }
+        scale += expNegative ? -exponent : exponent;
+    }
+
+    if (exact && scale >= -22 && scale <= 22) {
+        *value = (scale < 0) ? mantissa / powersOfTen[-scale] : mantissa * powersOfTen[scale];
+        *value = negative ? -*value : *value;
+        return p;
+    }
+
+    if (p < end) {
+        *value = strtod(text, NULL);
+        return p;
+    }
+
+    length = (size_t)(p - text);
+    copy = (length > PARSE_MAX_TOKEN) ? (char *)malloc(length + 1) : token;
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    *value = strtod(copy, NULL);
+
+    if (copy != token) {
+        free(copy);
+    }
+
+    return p;
+}
+
+
+/* 
+ * Function to parse data points from a text buffer 
+ * Input: text - the file contents (need not be NUL-terminated)
+ *        length - number of characters in text
+ *        X - output; one row per non-empty line; every line must hold the
+ *            same number of values
+ * Return: int - 0 on success, 1 if the text is not a matrix of numbers
+ */
+int parseData(const char *text, size_t length, Matrix *X) {
+    const char *p = text, *end = text + length;
+    double *values = NULL, *grown;
+    size_t count = 0, capacity = 0;
+    int rows = 0, cols = 0, lineCols;
+    double value;
+
+    while (p < end) {
+        lineCols = 0;
+
+        /* Parse one line. */
+        while (p < end && *p != '\n') {
+
+            if (isSeparator(*p)) {
+                p++;
+                continue;
+            }
+
+            p = parseDouble(p, end, &value);
+
+            if (p == NULL || (p < end && !isSeparator(*p))) {
+                free(values);
+                return 1;
+            }
+
+            if (count == capacity) {
+                capacity = (capacity > 0) ? 2 * capacity : 1024;
+                grown = (double *)realloc(values, capacity * sizeof(double));
+
+                if (grown == NULL) {
+                    free(values);
+                    printf("An Error Has Occurred");
+                    exit(1);
+                }
+                values = grown;
+            }
+
+            values[count++] = value;
+            lineCols++;
+        }
+        p++;
+
+        if (lineCols == 0) {
+            continue;
+        }
+
+        if (rows == 0) {
+            cols = lineCols;
+        }
+
+        if (lineCols != cols) {
+            free(values);
+            return 1;
+        }
+
+        rows++;
+    }
+
+    if (rows == 0) {
+        free(values);
+        return 1;
+    }
+
+    *X = createMatrix(rows, cols, values);
+    free(values);
+
+    return 0;
+}
+
+
+/* 
+ * Function to read data points from a file 
+ * Input: fileName - path to a text file, or to a binary matrix file
+ *        X - output; the data points from the file as a matrix (n x d)
+ * Return: int - 0 on success, 1 if the file cannot be read or parsed
+ */
+int readDataFile(const char *fileName, Matrix *X) {
+    MappedMatrix mapped;
+    struct stat info;
+    void *text;
+    int file, i, failed;
+
+    if (isMatrixFile(fileName)) {
+
+        if (mapMatrixFile(fileName, &mapped) != 0) {
+            return 1;
+        }
+
+        *X = createMatrix(mapped.matrix.rows, mapped.matrix.cols, NULL);
+        for (i = 0; i < X->rows; i++) {
+            memcpy(MATRIX_ROW(*X, i), MATRIX_ROW(mapped.matrix, i), X->cols * sizeof(double));
+        }
+
+        unmapMatrixFile(mapped);
+        return 0;
+    }
+
+    file = open(fileName, O_RDONLY);
+
+    if (file < 0 || fstat(file, &info) != 0 || info.st_size == 0) {
+        if (file >= 0) {
+            close(file);
+        }
+        return 1;
+    }
+
+    text = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+
+    if (text == MAP_FAILED) {
+        return 1;
+    }
+
+    failed = parseData((const char *)text, (size_t)info.st_size, X);
+    munmap(text, (size_t)info.st_size);
+
+    return failed;
+}
+
+
+/* 
+ * Function to read data points from a file and return them as a matrix 
+ * Input: fileName - path to a text file, or to a binary matrix file
+ * Return: Matrix - the data points from the file as a matrix (n x d); exits
+ *         with an error if the file cannot be read or parsed
+ */
+Matrix loadData(const char *fileName) {
+    Matrix X;
+
+    if (readDataFile(fileName, &X) != 0) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+    return X;
+}
+
+
+/* Function to tell whether a file starts with the binary matrix file magic. */
+int isMatrixFile(const char *fileName) {
+    char magic[sizeof(MATRIX_FILE_MAGIC) - 1];
+    FILE *file;
+    int matches;
+
+    file = fopen(fileName, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+
+    matches = (fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+               memcmp(magic, MATRIX_FILE_MAGIC, sizeof(magic)) == 0);
+    fclose(file);
+
+    return matches;
+}
+
+
+/* 
+ * Function to map a binary matrix file into memory, without copying it 
+ * Input: fileName - path to the binary matrix file
+ *        mapped - output; mapped->matrix is a read-only view of the data
+ * Return: int - 0 on success, 1 if the file cannot be mapped or is malformed
+ */
+int mapMatrixFile(const char *fileName, MappedMatrix *mapped) {
+    const MatrixFileHeader *header;
+    struct stat info;
+    size_t available;
+    int file;
+
+    file = open(fileName, O_RDONLY);
+
+    if (file < 0) {
+        return 1;
+    }
+
+    if (fstat(file, &info) != 0 || (size_t)info.st_size < sizeof(MatrixFileHeader)) {
+        close(file);
+        return 1;
+    }
+
+    mapped->length = (size_t)info.st_size;
+    /* Private and writable: writes land in copy-on-write pages, never in the file. */
+    mapped->mapping = mmap(NULL, mapped->length, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    close(file);
+
+    if (mapped->mapping == MAP_FAILED) {
+        return 1;
+    }
+
+    header = (const MatrixFileHeader *)mapped->mapping;
+    /* Elements that fit after the header; rows * stride is compared by
+     * division, so a crafted header cannot wrap the product past it. */
+    available = (mapped->length - sizeof(MatrixFileHeader)) / sizeof(double);
+
+    if (memcmp(header->magic, MATRIX_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->byteOrder != MATRIX_FILE_BYTE_ORDER || header->dtype != MATRIX_DTYPE_FLOAT64 ||
+        header->rows == 0 || header->cols == 0 || header->stride < header->cols ||
+        header->rows > 0x7fffffffU || header->stride > 0x7fffffffU ||
+        header->rows > available / header->stride) {
+        munmap(mapped->mapping, mapped->length);
+        return 1;
+    }
+
+    mapped->matrix.rows = (int)header->rows;
+    mapped->matrix.cols = (int)header->cols;
+    mapped->matrix.stride = (int)header->stride;
+    mapped->matrix.data = (double *)((char *)mapped->mapping + sizeof(MatrixFileHeader));
+    mapped->matrix.block = NULL;
+
+    return 0;
+}
+
+
+/* Function to release a mapping made by mapMatrixFile. */
+void unmapMatrixFile(MappedMatrix mapped) {
+    munmap(mapped.mapping, mapped.length);
+}
+
+
+/* 
+ * Function to write a matrix to a binary matrix file 
+ * Rows are written with the matrix's own stride, so the file maps back to
+ * the same layout.
+ * Input: fileName - path of the file to create or overwrite
+ *        matrix - the matrix to write
+ * Return: int - 0 on success, 1 if the file cannot be written
+ */
+int saveMatrixFile(const char *fileName, Matrix matrix) {
+    MatrixFileHeader header;
+    double *padding;
+    FILE *file;
+    int i, failed = 0;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic));
+    header.byteOrder = MATRIX_FILE_BYTE_ORDER;
+    header.dtype = MATRIX_DTYPE_FLOAT64;
+    header.rows = (unsigned int)matrix.rows;
+    header.cols = (unsigned int)matrix.cols;
+    header.stride = (unsigned int)matrix.stride;
+
+    padding = (double *)calloc((size_t)(matrix.stride - matrix.cols) + 1, sizeof(double));
+    file = fopen(fileName, "wb");
+
+    if (file == NULL || padding == NULL) {
+        free(padding);
+        if (file != NULL) {
+            fclose(file);
+        }
+        return 1;
+    }
+
+    failed = (fwrite(&header, sizeof(header), 1, file) != 1);
+
+    /* The padding at the end of each row is written as zeros. */
+    for (i = 0; i < matrix.rows && !failed; i++) {
+        failed = (fwrite(MATRIX_ROW(matrix, i), sizeof(double), matrix.cols, file) != (size_t)matrix.cols ||
+                  fwrite(padding, sizeof(double), matrix.stride - matrix.cols, file) != (size_t)(matrix.stride - matrix.cols));
+    }
+
+    free(padding);
+    failed = (fclose(file) != 0) || failed;
+
+    return failed;
+}
+
+
+/* 
+ * Function to create a matrix backed by a scratch file instead of memory 
+ * The file is laid out as a binary matrix file, mapped shared and unlinked
+ * at once: its pages are written back to disk and dropped under memory
+ * pressure, and the file disappears when the mapping is released.
+ * Input: fileName - path of the file to create; an existing file is replaced
+ *        rows, cols - dimensions of the matrix, initialized with zeros
+ *        mapped - output; release with unmapMatrixFile
+ * Return: int - 0 on success, 1 if the file cannot be created or mapped
+ */
+int createScratchMatrix(const char *fileName, int rows, int cols, MappedMatrix *mapped) {
+    MatrixFileHeader header;
+    size_t stride;
+    int file, failed;
+
+    stride = (size_t)cols;
+    if (stride >= MATRIX_ALIGN_DOUBLES) {
+        stride = (stride + MATRIX_ALIGN_DOUBLES - 1) / MATRIX_ALIGN_DOUBLES * MATRIX_ALIGN_DOUBLES;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic));
+    header.byteOrder = MATRIX_FILE_BYTE_ORDER;
+    header.dtype = MATRIX_DTYPE_FLOAT64;
+    header.rows = (unsigned int)rows;
+    header.cols = (unsigned int)cols;
+    header.stride = (unsigned int)stride;
+
+    mapped->length = sizeof(MatrixFileHeader) + (size_t)rows * stride * sizeof(double);
+
+    file = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (file < 0) {
+        return 1;
+    }
+
+    /* The file is sparse until rows are written. */
+    failed = (ftruncate(file, (off_t)mapped->length) != 0);
+    if (!failed) {
+        mapped->mapping = mmap(NULL, mapped->length, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        failed = (mapped->mapping == MAP_FAILED);
+    }
+    close(file);
+    unlink(fileName);
+
+    if (failed) {
+        return 1;
+    }
+
+    memcpy(mapped->mapping, &header, sizeof(header));
+
+    mapped->matrix.rows = rows;
+    mapped->matrix.cols = cols;
+    mapped->matrix.stride = (int)stride;
+    mapped->matrix.data = (double *)((char *)mapped->mapping + sizeof(MatrixFileHeader));
+    mapped->matrix.block = NULL;
+
+    return 0;
+}
+
+
+/* Function to start reading rows start..end-1 of a file-backed matrix in the
+ * background, so they are resident by the time they are used. */
+void prefetchMatrixRows(Matrix matrix, int start, int end) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    char *first = (char *)MATRIX_ROW(matrix, start);
+    char *last = (char *)MATRIX_ROW(matrix, end);
+    char *aligned = first - (size_t)first % page;
+
+    if (end > start) {
+        posix_madvise(aligned, (size_t)(last - aligned), POSIX_MADV_WILLNEED);
+    }
+}
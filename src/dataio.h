@@ -0,0 +1,42 @@
+#ifndef DATAIO_H
+#define DATAIO_H
+
+#include "matrix.h"
+
+#define MATRIX_FILE_MAGIC "SYMNMF01"    /* First 8 bytes of a binary matrix file. */
+#define MATRIX_FILE_BYTE_ORDER 0x01020304 /* Detects files written with another byte order. */
+#define MATRIX_FILE_HEADER_SIZE 64      /* Header bytes; keeps the data cache-line aligned. */
+#define MATRIX_DTYPE_FLOAT64 1          /* Elements are 8-byte IEEE doubles. */
+
+/* Header of a binary matrix file. It is followed by rows * stride elements,
+ * laid out exactly like Matrix storage, so the file can be mapped and used
+ * in place. */
+typedef struct {
+    char magic[8];          /* MATRIX_FILE_MAGIC, not NUL-terminated */
+    unsigned int byteOrder; /* MATRIX_FILE_BYTE_ORDER, in the writer's byte order */
+    unsigned int dtype;     /* Element type, MATRIX_DTYPE_FLOAT64 */
+    unsigned int rows;      /* Number of rows */
+    unsigned int cols;      /* Number of columns */
+    unsigned int stride;    /* Elements between the starts of consecutive rows */
+    char reserved[MATRIX_FILE_HEADER_SIZE - 28];
+} MatrixFileHeader;
+
+/* A binary matrix file mapped into memory. matrix is a view into the
+ * mapping; release it with unmapMatrixFile, not freeMatrix. */
+typedef struct {
+    Matrix matrix;  /* View of the file's elements */
+    void *mapping;  /* Start of the mapping */
+    size_t length;  /* Length of the mapping in bytes */
+} MappedMatrix;
+
+Matrix loadData(const char *fileName);
+int readDataFile(const char *fileName, Matrix *X);
+int parseData(const char *text, size_t length, Matrix *X);
+int isMatrixFile(const char *fileName);
+int mapMatrixFile(const char *fileName, MappedMatrix *mapped);
+void unmapMatrixFile(MappedMatrix mapped);
+int saveMatrixFile(const char *fileName, Matrix matrix);
+int createScratchMatrix(const char *fileName, int rows, int cols, MappedMatrix *mapped);
+void prefetchMatrixRows(Matrix matrix, int start, int end);
+
+#endif /* DATAIO_H */
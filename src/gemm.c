@@ -0,0 +1,349 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "gemm.h"
+#include "parallel.h"
+#include "smallk.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GEMM_X86
+#include <immintrin.h>
+#endif
+
+/* This C code implements the general matrix product C = alpha * A * B + beta * C.
+ * C is split into GEMM_MC x GEMM_NC blocks and the shared dimension into
+ * GEMM_KC slices, so the slice of B being reused stays in cache. Each block
+ * is computed by a kernel chosen at runtime: AVX-512, AVX2 + FMA, or a
+ * portable scalar loop. A result too narrow for a SIMD tile, such as W * H
+ * for k below GEMM_NR, would run entirely in the scalar edge loop; it is
+ * computed a row at a time by the small-k kernel for its width instead.
+ * That path does not slice the shared dimension: B is then only n x k, and
+ * streaming each row of A once through it measured faster than GEMM_KC
+ * slices, or 8192-row slices, up to n = 20000.
+ * Threads own disjoint row blocks of C, and every element is accumulated in
+ * the same order, so the result does not depend on the number of threads. */
+
+#define GEMM_MC 64  /* Rows of C per block. */
+#define GEMM_NC 512 /* Columns of C per block. */
+#define GEMM_KC 256 /* Length of a slice of the shared dimension. */
+#define GEMM_MR 4   /* Rows of C held in registers by the SIMD kernels. */
+#define GEMM_NR 8   /* Columns of the narrowest tile of C the SIMD kernels compute. */
+
+/* A block kernel adds alpha * a * b to c, where a is rows x depth,
+ * b is depth x cols and c is rows x cols; lda, ldb and ldc are strides. */
+typedef void (*GemmBlockKernel)(const double *a, int lda, const double *b, int ldb,
+                                double *c, int ldc, int rows, int cols, int depth, double alpha);
+
+
+/* Portable block kernel; also finishes the edges the SIMD tiles do not cover.
+ * It is never inlined into them, so it is compiled for the baseline CPU and
+ * adds exactly as the small-k kernels do, without fused multiply-adds. */
+#ifdef GEMM_X86
+__attribute__((noinline))
+#endif
+static void gemmBlockScalar(const double *a, int lda, const double *b, int ldb,
+                            double *c, int ldc, int rows, int cols, int depth, double alpha) {
+    int i, j, p;
+
+    for (i = 0; i < rows; i++) {
+        double *out = c + (size_t)i * ldc;
+
+        for (p = 0; p < depth; p++) {
+            const double *row = b + (size_t)p * ldb;
+            double scale = alpha * a[(size_t)i * lda + p];
+
+            for (j = 0; j < cols; j++) {
+                out[j] += scale * row[j];
+            }
+        }
+    }
+}
+
+
+#ifdef GEMM_X86
+
+/* AVX2 block kernel: 4 x 8 tiles of C in eight 256-bit accumulators. */
+__attribute__((target("avx2,fma")))
+static void gemmBlockAvx2(const double *a, int lda, const double *b, int ldb,
+                          double *c, int ldc, int rows, int cols, int depth, double alpha) {
+    __m256d c00, c01, c10, c11, c20, c21, c30, c31, b0, b1, a0, scale;
+    const double *a_0, *a_1, *a_2, *a_3, *bp;
+    double *out;
+    int i, j, p;
+
+    scale = _mm256_set1_pd(alpha);
+
+    for (i = 0; i + GEMM_MR <= rows; i += GEMM_MR) {
+        a_0 = a + (size_t)i * lda;
+        a_1 = a_0 + lda;
+        a_2 = a_1 + lda;
+        a_3 = a_2 + lda;
+
+        for (j = 0; j + 8 <= cols; j += 8) {
+            c00 = c01 = c10 = c11 = _mm256_setzero_pd();
+            c20 = c21 = c30 = c31 = _mm256_setzero_pd();
+
+            for (p = 0; p < depth; p++) {
+                bp = b + (size_t)p * ldb + j;
+                b0 = _mm256_loadu_pd(bp);
+                b1 = _mm256_loadu_pd(bp + 4);
+
+                a0 = _mm256_broadcast_sd(a_0 + p);
+                c00 = _mm256_fmadd_pd(a0, b0, c00);
+                c01 = _mm256_fmadd_pd(a0, b1, c01);
+                a0 = _mm256_broadcast_sd(a_1 + p);
+                c10 = _mm256_fmadd_pd(a0, b0, c10);
+                c11 = _mm256_fmadd_pd(a0, b1, c11);
+                a0 = _mm256_broadcast_sd(a_2 + p);
+                c20 = _mm256_fmadd_pd(a0, b0, c20);
+                c21 = _mm256_fmadd_pd(a0, b1, c21);
+                a0 = _mm256_broadcast_sd(a_3 + p);
+                c30 = _mm256_fmadd_pd(a0, b0, c30);
+                c31 = _mm256_fmadd_pd(a0, b1, c31);
+            }
+
+            out = c + (size_t)i * ldc + j;
+            _mm256_storeu_pd(out, _mm256_fmadd_pd(scale, c00, _mm256_loadu_pd(out)));
+            _mm256_storeu_pd(out + 4, _mm256_fmadd_pd(scale, c01, _mm256_loadu_pd(out + 4)));
+            out += ldc;
+            _mm256_storeu_pd(out, _mm256_fmadd_pd(scale, c10, _mm256_loadu_pd(out)));
+            _mm256_storeu_pd(out + 4, _mm256_fmadd_pd(scale, c11, _mm256_loadu_pd(out + 4)));
+            out += ldc;
+            _mm256_storeu_pd(out, _mm256_fmadd_pd(scale, c20, _mm256_loadu_pd(out)));
+            _mm256_storeu_pd(out + 4, _mm256_fmadd_pd(scale, c21, _mm256_loadu_pd(out + 4)));
+            out += ldc;
+            _mm256_storeu_pd(out, _mm256_fmadd_pd(scale, c30, _mm256_loadu_pd(out)));
+            _mm256_storeu_pd(out + 4, _mm256_fmadd_pd(scale, c31, _mm256_loadu_pd(out + 4)));
+        }
+
+        gemmBlockScalar(a_0, lda, b + j, ldb, c + (size_t)i * ldc + j, ldc, GEMM_MR, cols - j, depth, alpha);
+    }
+
+    gemmBlockScalar(a + (size_t)i * lda, lda, b, ldb, c + (size_t)i * ldc, ldc, rows - i, cols, depth, alpha);
+}
+
+
+/* AVX-512 block kernel: 4 x 16 tiles of C in eight 512-bit accumulators. */
+__attribute__((target("avx512f")))
+static void gemmBlockAvx512(const double *a, int lda, const double *b, int ldb,
+                            double *c, int ldc, int rows, int cols, int depth, double alpha) {
+    __m512d c00, c01, c10, c11, c20, c21, c30, c31, b0, b1, a0, scale;
+    const double *a_0, *a_1, *a_2, *a_3, *bp;
+    double *out;
+    int i, j, p;
+
+    scale = _mm512_set1_pd(alpha);
+
+    for (i = 0; i + GEMM_MR <= rows; i += GEMM_MR) {
+        a_0 = a + (size_t)i * lda;
+        a_1 = a_0 + lda;
+        a_2 = a_1 + lda;
+        a_3 = a_2 + lda;
+
+        for (j = 0; j + 16 <= cols; j += 16) {
+            c00 = c01 = c10 = c11 = _mm512_setzero_pd();
+            c20 = c21 = c30 = c31 = _mm512_setzero_pd();
+
+            for (p = 0; p < depth; p++) {
+                bp = b + (size_t)p * ldb + j;
+                b0 = _mm512_loadu_pd(bp);
+                b1 = _mm512_loadu_pd(bp + 8);
+
+                a0 = _mm512_set1_pd(a_0[p]);
+                c00 = _mm512_fmadd_pd(a0, b0, c00);
+                c01 = _mm512_fmadd_pd(a0, b1, c01);
+                a0 = _mm512_set1_pd(a_1[p]);
+                c10 = _mm512_fmadd_pd(a0, b0, c10);
+                c11 = _mm512_fmadd_pd(a0, b1, c11);
+                a0 = _mm512_set1_pd(a_2[p]);
+                c20 = _mm512_fmadd_pd(a0, b0, c20);
+                c21 = _mm512_fmadd_pd(a0, b1, c21);
+                a0 = _mm512_set1_pd(a_3[p]);
+                c30 = _mm512_fmadd_pd(a0, b0, c30);
+                c31 = _mm512_fmadd_pd(a0, b1, c31);
+            }
+
+            out = c + (size_t)i * ldc + j;
+            _mm512_storeu_pd(out, _mm512_fmadd_pd(scale, c00, _mm512_loadu_pd(out)));
+            _mm512_storeu_pd(out + 8, _mm512_fmadd_pd(scale, c01, _mm512_loadu_pd(out + 8)));
+            out += ldc;
+            _mm512_storeu_pd(out, _mm512_fmadd_pd(scale, c10, _mm512_loadu_pd(out)));
+            _mm512_storeu_pd(out + 8, _mm512_fmadd_pd(scale, c11, _mm512_loadu_pd(out + 8)));
+            out += ldc;
+            _mm512_storeu_pd(out, _mm512_fmadd_pd(scale, c20, _mm512_loadu_pd(out)));
+            _mm512_storeu_pd(out + 8, _mm512_fmadd_pd(scale, c21, _mm512_loadu_pd(out + 8)));
+            out += ldc;
+            _mm512_storeu_pd(out, _mm512_fmadd_pd(scale, c30, _mm512_loadu_pd(out)));
+            _mm512_storeu_pd(out + 8, _mm512_fmadd_pd(scale, c31, _mm512_loadu_pd(out + 8)));
+        }
+
+        gemmBlockAvx2(a_0, lda, b + j, ldb, c + (size_t)i * ldc + j, ldc, GEMM_MR, cols - j, depth, alpha);
+    }
+
+    gemmBlockAvx2(a + (size_t)i * lda, lda, b, ldb, c + (size_t)i * ldc, ldc, rows - i, cols, depth, alpha);
+}
+
+#endif /* GEMM_X86 */
+
+
+/* Function to pick the block kernel for this CPU.
+ * SYMNMF_GEMM_KERNEL can force a narrower kernel than the CPU supports. */
+static GemmBlockKernel chooseGemmKernel(const char **name) {
+    const char *forced = getenv(GEMM_KERNEL_ENV_VAR);
+
+#ifdef GEMM_X86
+    __builtin_cpu_init();
+
+    if (forced == NULL || strcmp(forced, "avx512") == 0) {
+
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            *name = "avx512";
+            return gemmBlockAvx512;
+        }
+    }
+
+    if (forced == NULL || strcmp(forced, "scalar") != 0) {
+
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            *name = "avx2";
+            return gemmBlockAvx2;
+        }
+    }
+#endif
+
+    (void)forced;
+    *name = "scalar";
+    return gemmBlockScalar;
+}
+
+
+/* Function to get the block kernel chooseGemmKernel picks. It is chosen on
+ * the first call only, so later calls, also from inside parallel regions,
+ * touch no environment. */
+static GemmBlockKernel selectGemmKernel(const char **name) {
+    static int selected = -1; /* 0 scalar, 1 avx2, 2 avx512; unknown until the first call */
+    GemmBlockKernel kernel;
+    int known;
+
+#pragma omp atomic read
+    known = selected;
+
+    if (known < 0) {
+        kernel = chooseGemmKernel(name);
+        known = (kernel == gemmBlockScalar) ? 0 : (strcmp(*name, "avx2") == 0) ? 1 : 2;
+#pragma omp atomic write
+        selected = known;
+    }
+
+#ifdef GEMM_X86
+    if (known == 2) {
+        *name = "avx512";
+        return gemmBlockAvx512;
+    }
+    if (known == 1) {
+        *name = "avx2";
+        return gemmBlockAvx2;
+    }
+#endif
+
+    *name = "scalar";
+    return gemmBlockScalar;
+}
+
+
+/* Function to get the name of the kernel gemm uses on this CPU. */
+const char *gemmKernelName(void) {
+    const char *name;
+
+    selectGemmKernel(&name);
+    return name;
+}
+
+
+/* Function to check the shapes of a gemm and pick the kernels for it;
+ * small is NULL unless the small-k row path computes it. */
+static GemmBlockKernel prepareGemm(Matrix matrix1, Matrix matrix2, Matrix result, const SmallKernels **small) {
+    GemmBlockKernel kernel;
+    const char *name;
+
+    if (matrix1.cols != matrix2.rows || result.rows != matrix1.rows || result.cols != matrix2.cols) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+    kernel = selectGemmKernel(&name);
+    *small = (kernel == gemmBlockScalar || result.cols < GEMM_NR) ? smallKernels(result.cols) : NULL;
+
+    return kernel;
+}
+
+
+/* Function to compute the rows rowStart to rowStart + rows - 1 of gemm, at
+ * most GEMM_MC of them, with the kernels prepareGemm picked. */
+static void gemmRows(GemmBlockKernel kernel, const SmallKernels *small, double alpha, Matrix matrix1,
+                     Matrix matrix2, double beta, Matrix result, int rowStart, int rows) {
+    int colStart, depthStart, cols, depth, i, j;
+
+    /* Scale the block by beta first; beta == 0 overwrites, ignoring NaNs in result. */
+    for (i = rowStart; i < rowStart + rows; i++) {
+        double *out = MATRIX_ROW(result, i);
+
+        for (j = 0; j < result.cols; j++) {
+            out[j] = (beta == 0.0) ? 0.0 : beta * out[j];
+        }
+        if (small != NULL) {
+            small->denseRow(MATRIX_ROW(matrix1, i), matrix1.cols, alpha, matrix2.data, matrix2.stride, out);
+        }
+    }
+
+    if (small != NULL) {
+        return;
+    }
+
+    for (colStart = 0; colStart < result.cols; colStart += GEMM_NC) {
+        cols = (result.cols - colStart < GEMM_NC) ? result.cols - colStart : GEMM_NC;
+
+        for (depthStart = 0; depthStart < matrix1.cols; depthStart += GEMM_KC) {
+            depth = (matrix1.cols - depthStart < GEMM_KC) ? matrix1.cols - depthStart : GEMM_KC;
+
+            kernel(MATRIX_ROW(matrix1, rowStart) + depthStart, matrix1.stride,
+                   MATRIX_ROW(matrix2, depthStart) + colStart, matrix2.stride,
+                   MATRIX_ROW(result, rowStart) + colStart, result.stride,
+                   rows, cols, depth, alpha);
+        }
+    }
+}
+
+
+/* 
+ * Function to compute result = alpha * matrix1 * matrix2 + beta * result 
+ * Input: alpha, beta - scalars
+ *        matrix1 - (m x k) matrix
+ *        matrix2 - (k x n) matrix
+ *        result - (m x n) output matrix; must not share storage with the inputs
+ */
+void gemm(double alpha, Matrix matrix1, Matrix matrix2, double beta, Matrix result) {
+    const SmallKernels *small;
+    GemmBlockKernel kernel = prepareGemm(matrix1, matrix2, result, &small);
+    int rowStart;
+
+#pragma omp parallel for num_threads(getNumThreads()) schedule(static)
+    for (rowStart = 0; rowStart < result.rows; rowStart += GEMM_MC) {
+        gemmRows(kernel, small, alpha, matrix1, matrix2, beta, result, rowStart,
+                 (result.rows - rowStart < GEMM_MC) ? result.rows - rowStart : GEMM_MC);
+    }
+}
+
+
+/* Function to compute gemm on the calling thread alone, with the same
+ * result; for callers that are already inside a parallel region. */
+void gemmSerial(double alpha, Matrix matrix1, Matrix matrix2, double beta, Matrix result) {
+    const SmallKernels *small;
+    GemmBlockKernel kernel = prepareGemm(matrix1, matrix2, result, &small);
+    int rowStart;
+
+    for (rowStart = 0; rowStart < result.rows; rowStart += GEMM_MC) {
+        gemmRows(kernel, small, alpha, matrix1, matrix2, beta, result, rowStart,
+                 (result.rows - rowStart < GEMM_MC) ? result.rows - rowStart : GEMM_MC);
+    }
+}
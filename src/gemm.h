@@ -0,0 +1,12 @@
+#ifndef GEMM_H
+#define GEMM_H
+
+#include "matrix.h"
+
+#define GEMM_KERNEL_ENV_VAR "SYMNMF_GEMM_KERNEL" /* Force "scalar", "avx2" or "avx512". */
+
+void gemm(double alpha, Matrix matrix1, Matrix matrix2, double beta, Matrix result);
+void gemmSerial(double alpha, Matrix matrix1, Matrix matrix2, double beta, Matrix result);
+const char *gemmKernelName(void);
+
+#endif /* GEMM_H */
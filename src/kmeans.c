@@ -0,0 +1,218 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "kmeans.h"
+#include "matrix.h"
+#include "parallel.h"
+#include "gemm.h"
+#include "rng.h"
+
+/* This C code clusters data points with Lloyd's algorithm (k-means),
+ * seeded with k-means++. The distances of all points to all centroids are
+ * computed together as one matrix product. */
+
+
+/* Function to copy row source of X into row target of centroids. */
+static void copyCentroid(Matrix X, int source, Matrix centroids, int target) {
+    memcpy(MATRIX_ROW(centroids, target), MATRIX_ROW(X, source), (size_t)X.cols * sizeof(double));
+}
+
+
+/* 
+ * Function to choose the initial centroids (k-means++) 
+ * The first centroid is a uniformly drawn point; every next one is a point
+ * drawn with probability proportional to its squared distance from the
+ * closest centroid chosen so far.
+ * Input: X - data matrix (n x d)
+ *        rng - random generator to draw from
+ *        centroids - output (k x d)
+ */
+static void seedKmeans(Matrix X, Rng *rng, Matrix centroids) {
+    double *closest, *previous;
+    double total, target, distance;
+    int chosen, c, i;
+
+    closest = (double *)malloc(((size_t)X.rows + 1) * sizeof(double));
+
+    if (closest == NULL) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+    chosen = (int)(uniformRng(rng) * X.rows);
+    copyCentroid(X, chosen < X.rows ? chosen : X.rows - 1, centroids, 0);
+
+    for (c = 1; c < centroids.rows; c++) {
+        previous = MATRIX_ROW(centroids, c - 1);
+
+#pragma omp parallel for num_threads(getNumThreads()) private(distance)
+        for (i = 0; i < X.rows; i++) {
+            distance = squaredEuclideanDistance(MATRIX_ROW(X, i), previous, X.cols);
+            if (c == 1 || distance < closest[i]) {
+                closest[i] = distance;
+            }
+        }
+
+        /* Summed in row order, so the draw does not depend on the thread count. */
+        total = 0.0;
+        for (i = 0; i < X.rows; i++) {
+            total += closest[i];
+        }
+
+        if (total > 0.0) {
+            target = uniformRng(rng) * total;
+            for (chosen = 0; chosen < X.rows - 1 && target >= closest[chosen]; chosen++) {
+                target -= closest[chosen];
+            }
+        }
+        else {
+            /* Every point sits on a centroid already. */
+            chosen = (int)(uniformRng(rng) * X.rows);
+            chosen = chosen < X.rows ? chosen : X.rows - 1;
+        }
+        copyCentroid(X, chosen, centroids, c);
+    }
+
+    free(closest);
+}
+
+
+/* 
+ * Function to assign every data point to its closest centroid 
+ * ||x - c||^2 = ||x||^2 - 2 x.c + ||c||^2, and ||x||^2 is the same for
+ * every centroid, so the closest centroid minimizes ||c||^2 - 2 x.c; the
+ * products x.c of all points come from one gemm.
+ * Input: X - data matrix (n x d)
+ *        centroids - current centroids (k x d)
+ *        transposed, cross - workspaces (d x k and n x k)
+ *        labels - output; n labels, the first closest centroid on ties
+ */
+static void assignKmeans(Matrix X, Matrix centroids, Matrix transposed, Matrix cross, int *labels) {
+    double centroidNorms[KMEANS_MAX_CLUSTERS];
+    double *products, value, best;
+    int c, i, j;
+
+    for (c = 0; c < centroids.rows; c++) {
+        centroidNorms[c] = dotProduct(MATRIX_ROW(centroids, c), MATRIX_ROW(centroids, c), centroids.cols);
+        for (j = 0; j < centroids.cols; j++) {
+            MATRIX_AT(transposed, j, c) = MATRIX_AT(centroids, c, j);
+        }
+    }
+
+    gemm(1.0, X, transposed, 0.0, cross);
+
+#pragma omp parallel for num_threads(getNumThreads()) private(products, value, best, c)
+    for (i = 0; i < X.rows; i++) {
+        products = MATRIX_ROW(cross, i);
+        labels[i] = 0;
+        best = centroidNorms[0] - 2.0 * products[0];
+        for (c = 1; c < centroids.rows; c++) {
+            value = centroidNorms[c] - 2.0 * products[c];
+            if (value < best) {
+                best = value;
+                labels[i] = c;
+            }
+        }
+    }
+}
+
+
+/* 
+ * Function to move every centroid to the mean of its points 
+ * A centroid without points stays where it is.
+ * Input: X - data matrix (n x d)
+ *        labels - cluster of every point
+ *        centroids - current centroids (k x d); updated in place
+ *        sums - workspace (k x d)
+ * Return: double - the largest squared distance a centroid moved
+ */
+static double updateKmeans(Matrix X, const int *labels, Matrix centroids, Matrix sums) {
+    int counts[KMEANS_MAX_CLUSTERS];
+    double *sum, shift, largest = 0.0;
+    int c, i, j;
+
+    for (c = 0; c < centroids.rows; c++) {
+        counts[c] = 0;
+        memset(MATRIX_ROW(sums, c), 0, (size_t)sums.cols * sizeof(double));
+    }
+
+    /* Summed in row order, so the centroids do not depend on the thread count. */
+    for (i = 0; i < X.rows; i++) {
+        sum = MATRIX_ROW(sums, labels[i]);
+        for (j = 0; j < X.cols; j++) {
+            sum[j] += MATRIX_AT(X, i, j);
+        }
+        counts[labels[i]]++;
+    }
+
+    for (c = 0; c < centroids.rows; c++) {
+        if (counts[c] == 0) {
+            continue;
+        }
+        sum = MATRIX_ROW(sums, c);
+        for (j = 0; j < sums.cols; j++) {
+            sum[j] /= counts[c];
+        }
+        shift = squaredEuclideanDistance(sum, MATRIX_ROW(centroids, c), centroids.cols);
+        largest = (shift > largest) ? shift : largest;
+        memcpy(MATRIX_ROW(centroids, c), sum, (size_t)centroids.cols * sizeof(double));
+    }
+
+    return largest;
+}
+
+
+/* 
+ * Function to cluster data points with k-means 
+ * Input: X - data matrix (n x d)
+ *        k - number of clusters, 1 <= k <= min(n, KMEANS_MAX_CLUSTERS)
+ *        iter - maximum number of iterations
+ *        eps - the iterations stop once no centroid moves more than eps
+ *        seed - seed of the k-means++ draws; equal seeds give equal results
+ *        centroids - if not NULL, output; the final centroids (k x d),
+ *                    release with freeMatrix
+ * Return: int* - n labels; label i is the centroid closest to point i.
+ *         Release with free.
+ */
+int *kmeans(Matrix X, int k, int iter, double eps, unsigned long seed, Matrix *centroids) {
+    Matrix current, transposed, cross, sums;
+    Rng rng;
+    int *labels;
+    int iteration;
+
+    labels = (int *)calloc((size_t)X.rows + 1, sizeof(int));
+
+    if (labels == NULL) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+    current = createZeroMatrix(k, X.cols);
+    transposed = createZeroMatrix(X.cols, k);
+    cross = createZeroMatrix(X.rows, k);
+    sums = createZeroMatrix(k, X.cols);
+
+    seedRng(&rng, seed);
+    seedKmeans(X, &rng, current);
+
+    for (iteration = 0; iteration < iter; iteration++) {
+        assignKmeans(X, current, transposed, cross, labels);
+        if (updateKmeans(X, labels, current, sums) <= eps * eps) {
+            break;
+        }
+    }
+    /* The labels of the final centroids. */
+    assignKmeans(X, current, transposed, cross, labels);
+
+    freeMatrix(transposed);
+    freeMatrix(cross);
+    freeMatrix(sums);
+    if (centroids != NULL) {
+        *centroids = current;
+    }
+    else {
+        freeMatrix(current);
+    }
+
+    return labels;
+}
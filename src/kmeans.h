@@ -0,0 +1,12 @@
+#ifndef KMEANS_H
+#define KMEANS_H
+
+#include "matrix.h"
+
+#define KMEANS_DEFAULT_ITER 300 /* Maximum number of Lloyd iterations. */
+#define KMEANS_DEFAULT_EPS 0.0001 /* Largest centroid move that counts as converged. */
+#define KMEANS_MAX_CLUSTERS 256 /* Largest number of clusters. */
+
+int *kmeans(Matrix X, int k, int iter, double eps, unsigned long seed, Matrix *centroids);
+
+#endif /* KMEANS_H */
@@ -1,130 +1,481 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 #include "matrix.h"
+#include "parallel.h"
+#include "gemm.h"
+#include "smallk.h"
+
+#define VECTOR_EXP_CHUNK 64 /* Elements per batch in vectorExp. */
 
 /* This C code defines a set of functions for creating,
  * manipulating, and performing operations on matrices. */
 
+static long allocationCount = 0; /* Allocations since the last resetAllocationStats. */
+static long allocationBytes = 0; /* Bytes they requested. */
+
+
+/* Function to record one allocation of matrix storage; safe in parallel regions. */
+void countAllocation(size_t bytes) {
+#pragma omp atomic
+    allocationCount++;
+#pragma omp atomic
+    allocationBytes += (long)bytes;
+}
+
+
+/* Function to read how many matrix allocations were made, and how many
+ * bytes they requested, since the last resetAllocationStats. */
+void allocationStats(long *count, long *bytes) {
+#pragma omp atomic read
+    *count = allocationCount;
+#pragma omp atomic read
+    *bytes = allocationBytes;
+}
+
+
+/* Function to restart the counts of allocationStats from zero. */
+void resetAllocationStats(void) {
+#pragma omp atomic write
+    allocationCount = 0;
+#pragma omp atomic write
+    allocationBytes = 0;
+}
+
+
+/* Function to get the stride of a matrix with cols columns: rows with at least
+ * a cache line of elements are padded to a whole number of cache lines, so
+ * every row starts aligned. */
+static size_t paddedCols(int cols, size_t elementSize) {
+    size_t perLine = MATRIX_ALIGNMENT / elementSize;
+    size_t padded = (size_t)cols;
+
+    if (padded >= perLine) {
+        padded = (padded + perLine - 1) / perLine * perLine;
+    }
+
+    return padded;
+}
+
+
+/* Function to get the bytes a rows x cols matrix of elementSize elements
+ * takes, including its padding and alignment; see allocateRows. */
+size_t matrixBytes(int rows, int cols, size_t elementSize) {
+    return (size_t)rows * paddedCols(cols, elementSize) * elementSize + MATRIX_ALIGNMENT;
+}
+
+
+/* Function to get the first cache-line-aligned byte of a block allocated
+ * with MATRIX_ALIGNMENT bytes to spare. */
+static char *alignedStart(void *block) {
+    char *aligned = (char *)block + MATRIX_ALIGNMENT - 1;
+
+    return aligned - (size_t)aligned % MATRIX_ALIGNMENT;
+}
+
+
+/* Function to allocate zeroed, cache-line-aligned storage for rows x cols elements.
+ * Return: 0 on success, 1 if the allocation failed (*block is NULL). */
+static int allocateRows(int rows, int cols, size_t elementSize, int *stride, void **block, void **data) {
+    size_t padded = paddedCols(cols, elementSize);
+    size_t bytes = (size_t)rows * padded * elementSize;
+
+    *block = calloc(1, bytes + MATRIX_ALIGNMENT);
+
+    if (*block == NULL) {
+        return 1;
+    }
+    countAllocation(bytes + MATRIX_ALIGNMENT);
+
+    *stride = (int)padded;
+    *data = alignedStart(*block);
+
+    return 0;
+}
+
+
+/* Function to allocate the storage of a rows x cols matrix, initialized with zeros.
+ * Return: 0 on success, 1 if the allocation failed (matrix is left empty). */
+int initMatrix(Matrix *matrix, int rows, int cols) {
+    void *data;
+
+    matrix->rows = 0;
+    matrix->cols = 0;
+    matrix->stride = 0;
+    matrix->data = NULL;
+
+    if (allocateRows(rows, cols, sizeof(double), &matrix->stride, &matrix->block, &data) != 0) {
+        return 1;
+    }
+
+    matrix->rows = rows;
+    matrix->cols = cols;
+    matrix->data = (double *)data;
+
+    return 0;
+}
+
+
 /* Function to create a matrix with given dimensions and values.
+ * values holds rows * cols elements in row-major order.
  * If values is NULL, the matrix is initialized with zeros. */
-Matrix createMatrix(int rows, int cols, double **values) {
+Matrix createMatrix(int rows, int cols, const double *values) {
+    Matrix matrix;
+    int i;
+
+    if (initMatrix(&matrix, rows, cols) != 0) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+    if (values != NULL) {
+
+        for (i = 0; i < rows; i++) {
+            memcpy(MATRIX_ROW(matrix, i), values + (size_t)i * cols, cols * sizeof(double));
+        }
+    }
+
+    return matrix;
+}
+
+/* Function to create a matrix with given dimensions initialized to zeros. */
+Matrix createZeroMatrix(int rows, int cols) {
+    return createMatrix(rows, cols, NULL);
+}
+
+
+/* Function to free the memory allocated for a matrix. */
+void freeMatrix(Matrix matrix) {
+    free(matrix.block);
+}
+
+
+/* Function to create an arena of the given size; one allocation holds
+ * everything later carved out of it. */
+Arena createArena(size_t bytes) {
+    size_t lines = bytes / MATRIX_ALIGNMENT + (bytes % MATRIX_ALIGNMENT != 0);
+    Arena arena;
+
+    /* The capacity is a whole number of cache lines, and one more aligns the base. */
+    if (lines > (size_t)-1 / MATRIX_ALIGNMENT - 1) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+    arena.capacity = lines * MATRIX_ALIGNMENT;
+
+    arena.block = calloc(1, arena.capacity + MATRIX_ALIGNMENT);
+    if (arena.block == NULL) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+    countAllocation(arena.capacity + MATRIX_ALIGNMENT);
+
+    arena.base = alignedStart(arena.block);
+    arena.used = 0;
+
+    return arena;
+}
+
+
+/* 
+ * Function to carve zeroed, cache-line-aligned storage out of an arena 
+ * The storage lives until the arena is freed; it is never freed
+ * on its own. Running out of room means the arena was sized wrong, and is
+ * treated like a failed allocation.
+ * Input: arena - the arena
+ *        bytes - size of the storage
+ * Return: void* - the storage
+ */
+void *arenaAlloc(Arena *arena, size_t bytes) {
+    size_t available = arena->capacity - arena->used;
+    char *storage;
+
+    /* available is a whole number of lines, so rounding bytes up cannot pass it. */
+    if (bytes > available) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+    storage = arena->base + arena->used;
+    arena->used += (bytes + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT * MATRIX_ALIGNMENT;
+    memset(storage, 0, bytes);
+
+    return storage;
+}
+
+
+/* Function to carve a rows x cols matrix of zeros out of an arena. The matrix
+ * does not own its storage (block == NULL), so freeMatrix leaves it alone. */
+Matrix arenaMatrix(Arena *arena, int rows, int cols) {
     Matrix matrix;
-    int i, j;
 
     matrix.rows = rows;
     matrix.cols = cols;
-    matrix.data = (double **)malloc(rows * sizeof(double *));
+    matrix.stride = (int)paddedCols(cols, sizeof(double));
+    matrix.data = (double *)arenaAlloc(arena, matrixBytes(rows, cols, sizeof(double)) - MATRIX_ALIGNMENT);
+    matrix.block = NULL;
+
+    return matrix;
+}
+
+
+/* Function to free the storage of an arena. */
+void freeArena(Arena arena) {
+    free(arena.block);
+}
 
-    if (matrix.data == NULL) {
+
+/* Function to create a single precision matrix with given dimensions initialized to zeros. */
+FloatMatrix createFloatMatrix(int rows, int cols) {
+    FloatMatrix matrix;
+    void *data;
+
+    if (allocateRows(rows, cols, sizeof(float), &matrix.stride, &matrix.block, &data) != 0) {
         printf("An Error Has Occurred");
         exit(1);
     }
 
-    for (i = 0; i < rows; i++) {
-        matrix.data[i] = (double *)malloc(cols * sizeof(double));
+    matrix.rows = rows;
+    matrix.cols = cols;
+    matrix.data = (float *)data;
 
-        if (matrix.data[i] == NULL) {
-            printf("An Error Has Occurred");
-            exit(1);
-        }
+    return matrix;
+}
 
-        if (values != NULL) {
 
-            for (j = 0; j < cols; j++) {
-                matrix.data[i][j] = values[i][j];
-            }
+/* Function to free the memory allocated for a single precision matrix. */
+void freeFloatMatrix(FloatMatrix matrix) {
+    free(matrix.block);
+}
 
-        } 
-        else {
 
-            for (j = 0; j < cols; j++) {
-                matrix.data[i][j] = 0.0;
-            }
-        }
+/* Function to view rows start to start + count - 1 of a matrix, without copying. */
+Matrix rowRange(Matrix matrix, int start, int count) {
+    Matrix view = matrix;
+
+    if (start < 0 || count < 0 || start + count > matrix.rows) {
+        printf("An Error Has Occurred");
+        exit(1);
     }
 
-    return matrix;
+    view.rows = count;
+    view.data = MATRIX_ROW(matrix, start);
+    view.block = NULL;
+
+    return view;
 }
 
-/* Function to create a matrix with given dimensions initialized to zeros. */
-Matrix createZeroMatrix(int rows, int cols) {
-    Matrix mat;
-    int i, j;
 
-    mat.rows = rows;
-    mat.cols = cols;
-    mat.data = (double **)malloc(rows * sizeof(double *));
+/* Function to view columns start to start + count - 1 of a matrix, without copying. */
+Matrix columnRange(Matrix matrix, int start, int count) {
+    Matrix view = matrix;
 
-    if (mat.data == NULL) {
+    if (start < 0 || count < 0 || start + count > matrix.cols) {
         printf("An Error Has Occurred");
         exit(1);
     }
 
-    for (i = 0; i < rows; i++) {
-        mat.data[i] = (double *)malloc(cols * sizeof(double));
+    view.cols = count;
+    view.data = matrix.data + start;
+    view.block = NULL;
 
-        if (mat.data[i] == NULL) {
-            printf("An Error Has Occurred");
-            exit(1);
-        }
+    return view;
+}
 
-        for (j = 0; j < cols; j++) {
-            mat.data[i][j] = 0.0;
-        }
+
+/* Function to view diagonal entries start to start + count - 1 of a diagonal
+ * matrix as a count x count diagonal matrix, without copying. */
+DiagMatrix diagRange(DiagMatrix diag, int start, int count) {
+    DiagMatrix view;
+
+    if (start < 0 || count < 0 || start + count > diag.size) {
+        printf("An Error Has Occurred");
+        exit(1);
     }
 
-    return mat;
+    view.size = count;
+    view.values = diag.values + start;
+
+    return view;
 }
 
 
-/* Function to free the memory allocated for a matrix. */
-void freeMatrix(Matrix matrix) {
+/* Function to test whether the half-open intervals [low1, high1) and [low2, high2) meet. */
+static int intervalsMeet(long low1, long high1, long low2, long high2) {
+    return low1 < high2 && low2 < high1;
+}
+
+
+/* 
+ * Function to test whether the storage of two matrices overlaps 
+ * Views with the same stride are compared row and column exactly, so
+ * disjoint column ranges of one matrix (see columnRange) do not overlap;
+ * otherwise the address ranges are compared.
+ */
+static int matricesOverlap(Matrix matrix1, Matrix matrix2) {
+    const double *end1, *end2;
+    long offset, shiftRows, shiftCols;
+
+    if (matrix1.rows == 0 || matrix1.cols == 0 || matrix2.rows == 0 || matrix2.cols == 0) {
+        return 0;
+    }
+
+    end1 = MATRIX_ROW(matrix1, matrix1.rows - 1) + matrix1.cols;
+    end2 = MATRIX_ROW(matrix2, matrix2.rows - 1) + matrix2.cols;
+    if (!(matrix1.data < end2 && matrix2.data < end1)) {
+        return 0;
+    }
+    if (matrix1.stride != matrix2.stride || matrix1.cols > matrix1.stride || matrix2.cols > matrix2.stride) {
+        return 1;
+    }
+
+    /* Element (i, j) of matrix2 is element (shiftRows + i, shiftCols + j) of
+     * matrix1, or of the next row where shiftCols + j passes the stride. */
+    offset = (long)(matrix2.data - matrix1.data);
+    shiftRows = (offset >= 0) ? offset / matrix1.stride : -((-offset + matrix1.stride - 1) / matrix1.stride);
+    shiftCols = offset - shiftRows * matrix1.stride;
+
+    return (intervalsMeet(shiftRows, shiftRows + matrix2.rows, 0, matrix1.rows) &&
+            intervalsMeet(shiftCols, shiftCols + matrix2.cols, 0, matrix1.cols)) ||
+           (shiftCols + matrix2.cols > matrix1.stride &&
+            intervalsMeet(shiftRows + 1, shiftRows + 1 + matrix2.rows, 0, matrix1.rows) &&
+            intervalsMeet(shiftCols - matrix1.stride, shiftCols + matrix2.cols - matrix1.stride, 0, matrix1.cols));
+}
+
+
+/* Function to test whether the storage of a single precision matrix and a
+ * double precision one overlaps. Their strides count different units, so
+ * only the address ranges are compared. */
+static int floatMatrixOverlaps(FloatMatrix matrix1, Matrix matrix2) {
+    const char *start1, *end1, *start2, *end2;
+
+    if (matrix1.rows == 0 || matrix1.cols == 0 || matrix2.rows == 0 || matrix2.cols == 0) {
+        return 0;
+    }
+
+    start1 = (const char *)matrix1.data;
+    end1 = (const char *)(MATRIX_ROW(matrix1, matrix1.rows - 1) + matrix1.cols);
+    start2 = (const char *)matrix2.data;
+    end2 = (const char *)(MATRIX_ROW(matrix2, matrix2.rows - 1) + matrix2.cols);
+
+    return start1 < end2 && start2 < end1;
+}
+
+
+/* Function to check the aliasing rule of the element-wise Into functions:
+ * result is either the operand itself or apart from it. */
+static void checkElementwiseAlias(Matrix operand, Matrix result) {
+    if (matricesOverlap(operand, result) && (operand.data != result.data || operand.stride != result.stride)) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+}
+
+
+/* Function to check the aliasing rule of the product Into functions:
+ * result is apart from the operand. */
+static void checkProductAlias(Matrix operand, Matrix result) {
+    if (matricesOverlap(operand, result)) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+}
+
+
+/* Function to copy a matrix into another of the same dimensions; either may be
+ * a view. source and target must not overlap. */
+void copyMatrixInto(Matrix source, Matrix target) {
     int i;
 
-    for (i = 0; i < matrix.rows; i++) {
-        free(matrix.data[i]);
+    if (source.rows != target.rows || source.cols != target.cols) {
+        printf("An Error Has Occurred");
+        exit(1);
     }
+    checkProductAlias(source, target);
 
-    free(matrix.data);
+    for (i = 0; i < source.rows; i++) {
+        memcpy(MATRIX_ROW(target, i), MATRIX_ROW(source, i), source.cols * sizeof(double));
+    }
 }
 
 
-/* Function to add two matrices of the same dimensions. */
-Matrix addMatrix(Matrix matrix1, Matrix matrix2) {
-    Matrix result;
+/* Function to compute result = matrix1 + matrix2 for matrices of the same
+ * dimensions; result may be matrix1 or matrix2. */
+void addMatrixInto(Matrix matrix1, Matrix matrix2, Matrix result) {
     int i, j;
 
-    if (matrix1.rows != matrix2.rows || matrix1.cols != matrix2.cols) {
+    if (matrix1.rows != matrix2.rows || matrix1.cols != matrix2.cols ||
+        result.rows != matrix1.rows || result.cols != matrix1.cols) {
         printf("An Error Has Occurred");
         exit(1);
     }
+    checkElementwiseAlias(matrix1, result);
+    checkElementwiseAlias(matrix2, result);
 
-    result = createMatrix(matrix1.rows, matrix1.cols, NULL);
-
+#pragma omp parallel for num_threads(getNumThreads()) private(j)
     for (i = 0; i < matrix1.rows; i++) {
+        double *out = MATRIX_ROW(result, i);
+        double *row1 = MATRIX_ROW(matrix1, i);
+        double *row2 = MATRIX_ROW(matrix2, i);
 
         for (j = 0; j < matrix1.cols; j++) {
-            result.data[i][j] = matrix1.data[i][j] + matrix2.data[i][j];
+            out[j] = row1[j] + row2[j];
         }
     }
+}
 
-    return result;
+
+/* Function to add matrix to target in place (target += matrix). */
+void addMatrixInPlace(Matrix target, Matrix matrix) {
+    addMatrixInto(target, matrix, target);
 }
 
 
 /* Function to add two matrices of the same dimensions. */
-Matrix multiplyScalarMatrix(Matrix matrix, double scalar) {
-    Matrix result;
+Matrix addMatrix(Matrix matrix1, Matrix matrix2) {
+    Matrix result = createMatrix(matrix1.rows, matrix1.cols, NULL);
+
+    addMatrixInto(matrix1, matrix2, result);
+
+    return result;
+}
+
+
+/* Function to compute result = scalar * matrix; result may be matrix. */
+void scaleMatrixInto(Matrix matrix, double scalar, Matrix result) {
     int i, j;
 
-    result = createMatrix(matrix.rows, matrix.cols, NULL);
+    if (result.rows != matrix.rows || result.cols != matrix.cols) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+    checkElementwiseAlias(matrix, result);
 
+#pragma omp parallel for num_threads(getNumThreads()) private(j)
     for (i = 0; i < matrix.rows; i++) {
+        double *out = MATRIX_ROW(result, i);
+        double *row = MATRIX_ROW(matrix, i);
+
         for (j = 0; j < matrix.cols; j++) {
-            result.data[i][j] = matrix.data[i][j] * scalar;
+            out[j] = row[j] * scalar;
         }
     }
+}
+
+
+/* Function to multiply a matrix by a scalar in place. */
+void scaleInPlace(Matrix matrix, double scalar) {
+    scaleMatrixInto(matrix, scalar, matrix);
+}
+
+
+/* Function to multiply a matrix by a scalar. */
+Matrix multiplyScalarMatrix(Matrix matrix, double scalar) {
+    Matrix result = createMatrix(matrix.rows, matrix.cols, NULL);
+
+    scaleMatrixInto(matrix, scalar, result);
+
     return result;
 }
 
@@ -137,7 +488,26 @@ void printMatrix(Matrix matrix) {
 
         for (j = 0; j < matrix.cols; j++) {
 
-            printf("%.4f", matrix.data[i][j]);
+            printf("%.4f", MATRIX_AT(matrix, i, j));
+
+            if (j < matrix.cols - 1)
+                printf(",");
+            else
+                printf("\n");
+        }
+    }
+}
+
+
+/* Function to print the elements of a single precision matrix, like printMatrix. */
+void printFloatMatrix(FloatMatrix matrix) {
+    int i, j;
+
+    for (i = 0; i < matrix.rows; i++) {
+
+        for (j = 0; j < matrix.cols; j++) {
+
+            printf("%.4f", MATRIX_AT(matrix, i, j));
 
             if (j < matrix.cols - 1)
                 printf(",");
@@ -148,13 +518,33 @@ void printMatrix(Matrix matrix) {
 }
 
 
+/* Function to test whether every element of a matrix is finite, neither
+ * infinite nor NaN; x - x is 0 exactly for finite x. */
+int isFiniteMatrix(Matrix matrix) {
+    int i, j;
+
+    for (i = 0; i < matrix.rows; i++) {
+        double *values = MATRIX_ROW(matrix, i);
+
+        for (j = 0; j < matrix.cols; j++) {
+            if (values[j] - values[j] != 0.0) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+
 /* Function to compute the sum of the elements in a specific row. */
 double sumRow(Matrix matrix, int row) {
+    double *values = MATRIX_ROW(matrix, row);
     double sum = 0.0;
     int j;
 
     for (j = 0; j < matrix.cols; j++) {
-        sum += matrix.data[row][j];
+        sum += values[j];
     }
 
     return sum;
@@ -166,12 +556,149 @@ double sumColumn(Matrix matrix, int col) {
     int i;
 
     for (i = 0; i < matrix.rows; i++) {
-        sum += matrix.data[i][col];
+        sum += MATRIX_AT(matrix, i, col);
+    }
+    return sum;
+}
+
+
+/* Function to compute the sum of a row of a single precision matrix, in double precision. */
+double sumFloatRow(FloatMatrix matrix, int row) {
+    float *values = MATRIX_ROW(matrix, row);
+    double sum = 0.0;
+    int j;
+
+    for (j = 0; j < matrix.cols; j++) {
+        sum += values[j];
     }
+
     return sum;
 }
 
 
+/* Function to compute the mean of all entries of a single precision matrix,
+ * in double precision; see meanMatrix. */
+double meanFloatMatrix(FloatMatrix matrix) {
+    double sum = 0.0;
+    double *rowSums;
+    int i;
+
+    rowSums = (double *)malloc(((size_t)matrix.rows + 1) * sizeof(double));
+
+    if (rowSums == NULL) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+#pragma omp parallel for num_threads(getNumThreads())
+    for (i = 0; i < matrix.rows; i++) {
+        rowSums[i] = sumFloatRow(matrix, i);
+    }
+
+    for (i = 0; i < matrix.rows; i++) {
+        sum += rowSums[i];
+    }
+
+    free(rowSums);
+
+    return sum / ((double)matrix.rows * matrix.cols);
+}
+
+
+/* Function to compute the mean of all entries of a matrix. */
+double meanMatrix(Matrix matrix) {
+    double sum = 0.0;
+    double *rowSums;
+    int i;
+
+    rowSums = (double *)malloc(((size_t)matrix.rows + 1) * sizeof(double));
+
+    if (rowSums == NULL) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+    /* Rows are summed in parallel and combined in order, as in frobeniusNorm. */
+#pragma omp parallel for num_threads(getNumThreads())
+    for (i = 0; i < matrix.rows; i++) {
+        rowSums[i] = sumRow(matrix, i);
+    }
+
+    for (i = 0; i < matrix.rows; i++) {
+        sum += rowSums[i];
+    }
+
+    free(rowSums);
+
+    return sum / ((double)matrix.rows * matrix.cols);
+}
+
+
+/* Function to compute the sum of the squares of all entries of a matrix,
+ * the squared Frobenius norm; rows are combined in order as in meanMatrix. */
+double squaredNormMatrix(Matrix matrix) {
+    double norm = 0.0;
+    double *rowNorms;
+    int i;
+
+    rowNorms = (double *)malloc(((size_t)matrix.rows + 1) * sizeof(double));
+
+    if (rowNorms == NULL) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+#pragma omp parallel for num_threads(getNumThreads())
+    for (i = 0; i < matrix.rows; i++) {
+        double *row = MATRIX_ROW(matrix, i);
+        rowNorms[i] = dotProduct(row, row, matrix.cols);
+    }
+
+    for (i = 0; i < matrix.rows; i++) {
+        norm += rowNorms[i];
+    }
+
+    free(rowNorms);
+
+    return norm;
+}
+
+
+/* Function to compute the squared Frobenius norm of a single precision
+ * matrix, in double precision; see squaredNormMatrix. */
+double squaredNormFloatMatrix(FloatMatrix matrix) {
+    double norm = 0.0;
+    double *rowNorms;
+    int i, j;
+
+    rowNorms = (double *)malloc(((size_t)matrix.rows + 1) * sizeof(double));
+
+    if (rowNorms == NULL) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+#pragma omp parallel for num_threads(getNumThreads()) private(j)
+    for (i = 0; i < matrix.rows; i++) {
+        float *row = MATRIX_ROW(matrix, i);
+        double sum = 0.0;
+
+        for (j = 0; j < matrix.cols; j++) {
+            sum += (double)row[j] * row[j];
+        }
+        rowNorms[i] = sum;
+    }
+
+    for (i = 0; i < matrix.rows; i++) {
+        norm += rowNorms[i];
+    }
+
+    free(rowNorms);
+
+    return norm;
+}
+
+
 /* Function to compute the squared Euclidean distance between two vectors. */
 double squaredEuclideanDistance(double *vector1, double *vector2, int size) {
     double sum = 0.0;
@@ -186,72 +713,378 @@ double squaredEuclideanDistance(double *vector1, double *vector2, int size) {
 }
 
 
-/* Function to raise the diagonal elements of a matrix to a given power. /
- * Power values are from R*/
-Matrix powerDiagMatrix(Matrix matrix, double power) {
-    Matrix result;
+/* Function to compute the dot product of two vectors. */
+double dotProduct(double *vector1, double *vector2, int size) {
+    double sum = 0.0;
     int i;
 
-    result = createMatrix(matrix.rows, matrix.cols, NULL);
+    for (i = 0; i < size; i++) {
+        sum += vector1[i] * vector2[i];
+    }
 
-    for (i = 0; i < matrix.rows; i++) {
-        result.data[i][i] = pow(matrix.data[i][i], power);
+    return sum;
+}
+
+
+/* Function to replace each element of an array with its exponent, in place.
+ * Arguments are reduced to x = n * ln2 + r with |r| <= ln2 / 2, and e^r is
+ * evaluated by a branch-free degree 13 polynomial the compiler can
+ * vectorize; only the final scaling by 2^n is done per element. */
+void vectorExp(double *values, int size) {
+    const double log2e = 1.4426950408889634;
+    const double ln2High = 6.93147180369123816490e-01;
+    const double ln2Low = 1.90821492927058770002e-10;
+    double exponents[VECTOR_EXP_CHUNK];
+    double x, n, r, p;
+    int start, count, i;
+
+    for (start = 0; start < size; start += VECTOR_EXP_CHUNK) {
+        count = (size - start < VECTOR_EXP_CHUNK) ? size - start : VECTOR_EXP_CHUNK;
+
+        for (i = 0; i < count; i++) {
+            x = values[start + i];
+            x = (x < -746.0) ? -746.0 : ((x > 710.0) ? 710.0 : x);
+            n = floor(x * log2e + 0.5);
+            r = (x - n * ln2High) - n * ln2Low;
+
+            p = 1.0 / 6227020800.0;
+            p = p * r + 1.0 / 479001600.0;
+            p = p * r + 1.0 / 39916800.0;
+            p = p * r + 1.0 / 3628800.0;
+            p = p * r + 1.0 / 362880.0;
+            p = p * r + 1.0 / 40320.0;
+            p = p * r + 1.0 / 5040.0;
+            p = p * r + 1.0 / 720.0;
+            p = p * r + 1.0 / 120.0;
+            p = p * r + 1.0 / 24.0;
+            p = p * r + 1.0 / 6.0;
+            p = p * r + 0.5;
+            p = p * r + 1.0;
+            p = p * r + 1.0;
+
+            values[start + i] = p;
+            exponents[i] = n;
+        }
+
+        for (i = 0; i < count; i++) {
+            values[start + i] = ldexp(values[start + i], (int)exponents[i]);
+        }
+    }
+}
+
+
+/* Function to create a size x size diagonal matrix initialized to zeros. */
+DiagMatrix createDiagMatrix(int size) {
+    DiagMatrix diag;
+
+    diag.size = size;
+    diag.values = (double *)calloc((size_t)size + 1, sizeof(double));
+
+    if (diag.values == NULL) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+    countAllocation(((size_t)size + 1) * sizeof(double));
+
+    return diag;
+}
+
+
+/* Function to free the memory allocated for a diagonal matrix. */
+void freeDiagMatrix(DiagMatrix diag) {
+    free(diag.values);
+}
+
+
+/* Function to print a diagonal matrix in the same format as printMatrix,
+ * writing the off-diagonal zeros without ever storing them. */
+void printDiagMatrix(DiagMatrix diag) {
+    int i, j;
+
+    for (i = 0; i < diag.size; i++) {
+
+        for (j = 0; j < diag.size; j++) {
+
+            printf("%.4f", (i == j) ? diag.values[i] : 0.0);
+
+            if (j < diag.size - 1)
+                printf(",");
+            else
+                printf("\n");
+        }
+    }
+}
+
+
+/* Function to raise the diagonal elements of a matrix to a given power into
+ * result of the same size; result may be diag. Power values are from R */
+void powerDiagMatrixInto(DiagMatrix diag, double power, DiagMatrix result) {
+    int i;
+
+    if (result.size != diag.size) {
+        printf("An Error Has Occurred");
+        exit(1);
     }
 
+    for (i = 0; i < diag.size; i++) {
+        result.values[i] = pow(diag.values[i], power);
+    }
+}
+
+
+/* Function to raise the diagonal elements of a matrix to a given power.
+ * Power values are from R */
+DiagMatrix powerDiagMatrix(DiagMatrix diag, double power) {
+    DiagMatrix result = createDiagMatrix(diag.size);
+
+    powerDiagMatrixInto(diag, power, result);
+
     return result;
 }
 
 
-/* Function to multiply two matrices of right sizes. */
-Matrix multiplyMatrix(Matrix matrix1, Matrix matrix2) {
-    Matrix result;
-    int i, j, k;
+/* Function to compute left * matrix * right for diagonal left and right.
+ * This scales row i by left[i] and column j by right[j] in O(rows * cols). */
+Matrix scaleDiagMatrix(DiagMatrix left, Matrix matrix, DiagMatrix right) {
+    Matrix result = createMatrix(matrix.rows, matrix.cols, NULL);
+
+    scaleDiagMatrixInto(left, matrix, right, result);
+
+    return result;
+}
+
+
+/* Function to write left * matrix * right, for diagonal left and right, into
+ * result; result may be matrix, which scales it in place. */
+void scaleDiagMatrixInto(DiagMatrix left, Matrix matrix, DiagMatrix right, Matrix result) {
+    int i, j;
 
-    if (matrix1.cols != matrix2.rows) {
+    if (left.size != matrix.rows || matrix.cols != right.size ||
+        result.rows != matrix.rows || result.cols != matrix.cols) {
         printf("An Error Has Occurred");
         exit(1);
     }
+    checkElementwiseAlias(matrix, result);
+
+#pragma omp parallel for num_threads(getNumThreads()) private(j)
+    for (i = 0; i < matrix.rows; i++) {
+        double *out = MATRIX_ROW(result, i);
+        double *row = MATRIX_ROW(matrix, i);
+        double scale = left.values[i];
+
+        for (j = 0; j < matrix.cols; j++) {
+            out[j] = scale * row[j] * right.values[j];
+        }
+    }
+}
 
-    result = createZeroMatrix(matrix1.rows, matrix2.cols);
 
+/* Function to replace a single precision matrix with left * matrix * right,
+ * for diagonal left and right, in place; see scaleDiagMatrix. */
+void scaleDiagFloatMatrix(DiagMatrix left, FloatMatrix matrix, DiagMatrix right) {
+    int i, j;
+
+    if (left.size != matrix.rows || matrix.cols != right.size) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+#pragma omp parallel for num_threads(getNumThreads()) private(j)
+    for (i = 0; i < matrix.rows; i++) {
+        float *row = MATRIX_ROW(matrix, i);
+        double scale = left.values[i];
+
+        for (j = 0; j < matrix.cols; j++) {
+            row[j] = (float)(scale * row[j] * right.values[j]);
+        }
+    }
+}
+
+
+/* Function to compute result = matrix1 * matrix2 for a single precision matrix1.
+ * Entries of matrix1 are widened as they are read, so products and sums are
+ * done in double precision; only the memory traffic for matrix1 is halved.
+ * result must not overlap either operand. */
+void multiplyFloatMatrixInto(FloatMatrix matrix1, Matrix matrix2, Matrix result) {
+    const SmallKernels *small = smallKernels(result.cols);
+    int i, j, c;
+
+    if (matrix1.cols != matrix2.rows || result.rows != matrix1.rows || result.cols != matrix2.cols) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+    checkProductAlias(matrix2, result);
+    if (floatMatrixOverlaps(matrix1, result)) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+#pragma omp parallel for num_threads(getNumThreads()) private(j, c)
     for (i = 0; i < matrix1.rows; i++) {
-        for (j = 0; j < matrix2.cols; j++) {
-            for (k = 0; k < matrix1.cols; k++) {
-                result.data[i][j] += matrix1.data[i][k] * matrix2.data[k][j];
+        float *row = MATRIX_ROW(matrix1, i);
+        double *out = MATRIX_ROW(result, i);
+
+        for (c = 0; c < result.cols; c++) {
+            out[c] = 0.0;
+        }
+
+        if (small != NULL) {
+            small->floatRow(row, matrix1.cols, matrix2.data, matrix2.stride, out);
+            continue;
+        }
+
+        for (j = 0; j < matrix1.cols; j++) {
+            double value = row[j];
+            double *other = MATRIX_ROW(matrix2, j);
+
+            for (c = 0; c < result.cols; c++) {
+                out[c] += value * other[c];
             }
         }
     }
+}
+
+
+/* Function to compute result = matrix1 * matrix2 into an existing
+ * matrix1.rows x matrix2.cols matrix; result must not overlap either operand. */
+void multiplyMatrixInto(Matrix matrix1, Matrix matrix2, Matrix result) {
+    if (matrix1.cols != matrix2.rows || result.rows != matrix1.rows || result.cols != matrix2.cols) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+    checkProductAlias(matrix1, result);
+    checkProductAlias(matrix2, result);
+
+    gemm(1.0, matrix1, matrix2, 0.0, result);
+}
+
+
+/* Function to multiply two matrices of right sizes. */
+Matrix multiplyMatrix(Matrix matrix1, Matrix matrix2) {
+    Matrix result = createZeroMatrix(matrix1.rows, matrix2.cols);
+
+    multiplyMatrixInto(matrix1, matrix2, result);
 
     return result;
 }
 
 
-/* Function to transpose a matrix. */
-Matrix transposeMatrix(Matrix matrix) {
-    Matrix result;
+/* Function to transpose a matrix into an existing cols x rows matrix;
+ * result must not overlap matrix. */
+void transposeMatrixInto(Matrix matrix, Matrix result) {
     int i, j;
 
-    result = createMatrix(matrix.cols, matrix.rows, NULL);
+    if (result.rows != matrix.cols || result.cols != matrix.rows) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+    checkProductAlias(matrix, result);
 
     for (i = 0; i < matrix.rows; i++) {
         for (j = 0; j < matrix.cols; j++) {
-            result.data[j][i] = matrix.data[i][j];
+            MATRIX_AT(result, j, i) = MATRIX_AT(matrix, i, j);
         }
     }
+}
+
+
+/* Function to transpose a matrix. */
+Matrix transposeMatrix(Matrix matrix) {
+    Matrix result = createMatrix(matrix.cols, matrix.rows, NULL);
+
+    transposeMatrixInto(matrix, result);
 
     return result;
 }
 
 
+/* Function to compute the Gram matrix transpose(matrix) * matrix (cols x cols)
+ * in one pass over the rows, without forming the transpose. */
+Matrix gramMatrix(Matrix matrix) {
+    Matrix gram;
+
+    gram = createZeroMatrix(matrix.cols, matrix.cols);
+    gramMatrixInto(matrix, gram);
+
+    return gram;
+}
+
+
+/* Function to compute the Gram matrix of matrix into an existing cols x cols
+ * matrix; gram must not overlap matrix. */
+void gramMatrixInto(Matrix matrix, Matrix gram) {
+    const SmallKernels *small = smallKernels(matrix.cols);
+    int i, a, b;
+
+    if (gram.rows != matrix.cols || gram.cols != matrix.cols) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+    checkProductAlias(matrix, gram);
+
+    if (small != NULL) {
+        small->gram(matrix.data, matrix.stride, matrix.rows, gram.data, gram.stride);
+        return;
+    }
+
+    for (a = 0; a < gram.rows; a++) {
+        memset(MATRIX_ROW(gram, a), 0, gram.cols * sizeof(double));
+    }
+
+    for (i = 0; i < matrix.rows; i++) {
+        double *row = MATRIX_ROW(matrix, i);
+
+        for (a = 0; a < matrix.cols; a++) {
+            double *out = MATRIX_ROW(gram, a);
+            double scale = row[a];
+
+            for (b = a; b < matrix.cols; b++) {
+                out[b] += scale * row[b];
+            }
+        }
+    }
+
+    for (a = 0; a < matrix.cols; a++) {
+        for (b = 0; b < a; b++) {
+            MATRIX_AT(gram, a, b) = MATRIX_AT(gram, b, a);
+        }
+    }
+}
+
+
 /* Function to compute the Frobenius norm between two matrices. */
 double frobeniusNorm(Matrix matrix1, Matrix matrix2) {
     double norm = 0.0;
+    double *rowNorms;
     int i, j;
+
+    rowNorms = (double *)malloc(((size_t)matrix1.rows + 1) * sizeof(double));
+
+    if (rowNorms == NULL) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+    /* Rows are summed in parallel and combined in order, so the result
+     * does not depend on the number of threads. */
+#pragma omp parallel for num_threads(getNumThreads()) private(j)
     for (i = 0; i < matrix1.rows; i++) {
+        double *row1 = MATRIX_ROW(matrix1, i);
+        double *row2 = MATRIX_ROW(matrix2, i);
+        double sum = 0.0;
+
         for (j = 0; j < matrix1.cols; j++) {
-            double diff = matrix1.data[i][j] - matrix2.data[i][j];
-            norm += diff * diff;
+            double diff = row1[j] - row2[j];
+            sum += diff * diff;
         }
+        rowNorms[i] = sum;
     }
+
+    for (i = 0; i < matrix1.rows; i++) {
+        norm += rowNorms[i];
+    }
+
+    free(rowNorms);
+
     return sqrt(norm);
 }
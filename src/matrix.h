@@ -1,25 +1,119 @@
 #ifndef MATRIX_H
 #define MATRIX_H
 
-/* Define a structure for Matrix with rows, cols, and data */
+#include <stddef.h>
+
+#define MATRIX_ALIGNMENT 64 /* Byte alignment of matrix storage; one cache line. */
+#define MATRIX_ALIGN_DOUBLES (MATRIX_ALIGNMENT / sizeof(double))
+
+/* Define a structure for Matrix with rows, cols, and data.
+ * The elements live in one row-major, cache-line-aligned allocation;
+ * row i starts at data + i * stride. */
 typedef struct {
     int rows;       /* Number of rows in the matrix */
     int cols;       /* Number of columns in the matrix */
-    double **data;  /* Pointer to the matrix data */
+    int stride;     /* Leading dimension: elements between consecutive rows */
+    double *data;   /* Pointer to the first element of the matrix */
+    void *block;    /* Allocation owning data; NULL if the matrix does not own it */
 } Matrix;
 
-Matrix createMatrix(int rows, int cols, double **values);
+/* Define a structure for a single precision matrix, laid out like Matrix.
+ * It stores the large n x n matrices in half the memory; arithmetic on its
+ * entries is still done in double precision. */
+typedef struct {
+    int rows;       /* Number of rows in the matrix */
+    int cols;       /* Number of columns in the matrix */
+    int stride;     /* Leading dimension: elements between consecutive rows */
+    float *data;    /* Pointer to the first element of the matrix */
+    void *block;    /* Allocation owning data; NULL if the matrix does not own it */
+} FloatMatrix;
+
+/* Storage precision of the similarity and normalized matrices. */
+typedef enum {
+    PRECISION_DOUBLE, /* Matrix */
+    PRECISION_SINGLE  /* FloatMatrix */
+} Precision;
+
+/* Define a structure for a square diagonal matrix, stored as its diagonal only. */
+typedef struct {
+    int size;        /* Number of rows (and columns) of the matrix */
+    double *values;  /* Diagonal entries; every off-diagonal entry is zero */
+} DiagMatrix;
+
+/* Define a structure for a workspace that matrices are carved out of: one
+ * allocation, sized up front for a whole job, released all at once. */
+typedef struct {
+    char *base;       /* First byte, aligned to MATRIX_ALIGNMENT */
+    size_t capacity;  /* Bytes available */
+    size_t used;      /* Bytes carved out so far */
+    void *block;      /* Allocation owning base */
+} Arena;
+
+/* The functions named ...Into write their result into existing storage, which
+ * may be a view (see rowRange and columnRange), and allocate nothing.
+ * Aliasing rules: the element-wise ones (addMatrixInto, scaleMatrixInto,
+ * scaleDiagMatrixInto, powerDiagMatrixInto) accept a result that is one of
+ * their operands, which computes in place; the others (copyMatrixInto,
+ * multiplyMatrixInto, transposeMatrixInto, gramMatrixInto,
+ * multiplyFloatMatrixInto) need a result apart from every operand. Storage
+ * that partly overlaps is an error in both. */
+
+/* Pointer to the first element of a row, and a single element; for Matrix and FloatMatrix. */
+#define MATRIX_ROW(matrix, row) ((matrix).data + (size_t)(row) * (matrix).stride)
+#define MATRIX_AT(matrix, row, col) (MATRIX_ROW(matrix, row)[col])
+
+void countAllocation(size_t bytes);
+void allocationStats(long *count, long *bytes);
+void resetAllocationStats(void);
+size_t matrixBytes(int rows, int cols, size_t elementSize);
+int initMatrix(Matrix *matrix, int rows, int cols);
+Matrix createMatrix(int rows, int cols, const double *values);
 Matrix createZeroMatrix(int rows, int cols);
 void freeMatrix(Matrix matrix);
+Arena createArena(size_t bytes);
+void *arenaAlloc(Arena *arena, size_t bytes);
+Matrix arenaMatrix(Arena *arena, int rows, int cols);
+void freeArena(Arena arena);
+FloatMatrix createFloatMatrix(int rows, int cols);
+void freeFloatMatrix(FloatMatrix matrix);
+Matrix rowRange(Matrix matrix, int start, int count);
+Matrix columnRange(Matrix matrix, int start, int count);
+DiagMatrix diagRange(DiagMatrix diag, int start, int count);
+void copyMatrixInto(Matrix source, Matrix target);
+void addMatrixInto(Matrix matrix1, Matrix matrix2, Matrix result);
+void addMatrixInPlace(Matrix target, Matrix matrix);
 Matrix addMatrix(Matrix matrix1, Matrix matrix2);
+void scaleMatrixInto(Matrix matrix, double scalar, Matrix result);
+void scaleInPlace(Matrix matrix, double scalar);
 Matrix multiplyScalarMatrix(Matrix matrix, double scalar);
 void printMatrix(Matrix matrix);
+void printFloatMatrix(FloatMatrix matrix);
+int isFiniteMatrix(Matrix matrix);
 double sumRow(Matrix matrix, int row);
 double sumColumn(Matrix matrix, int col);
+double meanMatrix(Matrix matrix);
+double sumFloatRow(FloatMatrix matrix, int row);
+double meanFloatMatrix(FloatMatrix matrix);
+double squaredNormMatrix(Matrix matrix);
+double squaredNormFloatMatrix(FloatMatrix matrix);
 double squaredEuclideanDistance(double *vector1, double *vector2, int size);
-Matrix powerDiagMatrix(Matrix matrix, double power);
+double dotProduct(double *vector1, double *vector2, int size);
+void vectorExp(double *values, int size);
+DiagMatrix createDiagMatrix(int size);
+void freeDiagMatrix(DiagMatrix diag);
+void printDiagMatrix(DiagMatrix diag);
+void powerDiagMatrixInto(DiagMatrix diag, double power, DiagMatrix result);
+DiagMatrix powerDiagMatrix(DiagMatrix diag, double power);
+Matrix scaleDiagMatrix(DiagMatrix left, Matrix matrix, DiagMatrix right);
+void scaleDiagMatrixInto(DiagMatrix left, Matrix matrix, DiagMatrix right, Matrix result);
+void scaleDiagFloatMatrix(DiagMatrix left, FloatMatrix matrix, DiagMatrix right);
+void multiplyFloatMatrixInto(FloatMatrix matrix1, Matrix matrix2, Matrix result);
+void multiplyMatrixInto(Matrix matrix1, Matrix matrix2, Matrix result);
 Matrix multiplyMatrix(Matrix matrix1, Matrix matrix2);
+void transposeMatrixInto(Matrix matrix, Matrix result);
 Matrix transposeMatrix(Matrix matrix);
+Matrix gramMatrix(Matrix matrix);
+void gramMatrixInto(Matrix matrix, Matrix gram);
 double frobeniusNorm(Matrix matrix1, Matrix matrix2);
 
 #endif /* MATRIX_H */
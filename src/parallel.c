@@ -0,0 +1,48 @@
+#include <stdlib.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "parallel.h"
+
+/* This C code holds the thread count used by the parallel row loops.
+ * Every parallel loop writes disjoint rows, and reductions are summed in
+ * row order, so results do not depend on the number of threads. */
+
+/* Each calling thread has its own setting, so concurrent callers (such as
+ * Python threads running without the GIL) do not change each other's count. */
+static int numThreads = 0; /* 0 means: not set explicitly */
+#pragma omp threadprivate(numThreads)
+
+
+/* Function to set the number of threads for the parallel loops.
+ * A value below 1 restores the default (environment, then OpenMP). */
+void setNumThreads(int threads) {
+    numThreads = (threads > 0) ? threads : 0;
+}
+
+
+/* Function to get the number of threads for the parallel loops.
+ * Priority: setNumThreads, then SYMNMF_NUM_THREADS, then the OpenMP default. */
+int getNumThreads(void) {
+    const char *env;
+    int threads;
+
+    if (numThreads > 0) {
+        return numThreads;
+    }
+
+    env = getenv(THREADS_ENV_VAR);
+    if (env != NULL) {
+        threads = atoi(env);
+
+        if (threads > 0) {
+            return threads;
+        }
+    }
+
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
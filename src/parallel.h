@@ -0,0 +1,9 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#define THREADS_ENV_VAR "SYMNMF_NUM_THREADS" /* Environment override for the thread count. */
+
+void setNumThreads(int threads);
+int getNumThreads(void);
+
+#endif /* PARALLEL_H */
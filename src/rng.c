@@ -0,0 +1,58 @@
+#include "rng.h"
+
+/* This C code holds a small reproducible random number generator, so runs
+ * seeded alike give the same numbers on every platform and thread count. */
+
+#define RNG_MASK 0xffffffffUL /* Words are kept to 32 bits. */
+
+
+/* Function to scramble a 32 bit value (lowbias32 hash). */
+static unsigned long mixRngWord(unsigned long x) {
+    x &= RNG_MASK;
+    x ^= x >> 16;
+    x = (x * 0x7feb352dUL) & RNG_MASK;
+    x ^= x >> 15;
+    x = (x * 0x846ca68bUL) & RNG_MASK;
+    x ^= x >> 16;
+    return x;
+}
+
+
+/* Function to start the generator from a seed.
+ * Nearby seeds give unrelated sequences, and the state is never all zero. */
+void seedRng(Rng *rng, unsigned long seed) {
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        rng->state[i] = mixRngWord(seed + 0x9e3779b9UL * (unsigned long)(i + 1));
+    }
+
+    if ((rng->state[0] | rng->state[1] | rng->state[2] | rng->state[3]) == 0) {
+        rng->state[0] = 1;
+    }
+}
+
+
+/* Function to draw the next 32 bit value (Marsaglia's xorshift128). */
+unsigned long nextRng(Rng *rng) {
+    unsigned long t = rng->state[0];
+    unsigned long w = rng->state[3];
+
+    t ^= (t << 11) & RNG_MASK;
+    t ^= t >> 8;
+    rng->state[0] = rng->state[1];
+    rng->state[1] = rng->state[2];
+    rng->state[2] = w;
+    rng->state[3] = w ^ (w >> 19) ^ t;
+
+    return rng->state[3];
+}
+
+
+/* Function to draw a double uniformly from [0, 1), with 53 random bits. */
+double uniformRng(Rng *rng) {
+    unsigned long high = nextRng(rng) >> 5;
+    unsigned long low = nextRng(rng) >> 6;
+
+    return (high * 67108864.0 + low) / 9007199254740992.0;
+}
@@ -0,0 +1,14 @@
+#ifndef RNG_H
+#define RNG_H
+
+/* State of a xorshift128 generator. Each word holds 32 bits, so the
+ * sequence for a seed is the same wherever unsigned long is wider. */
+typedef struct {
+    unsigned long state[4];
+} Rng;
+
+void seedRng(Rng *rng, unsigned long seed);
+unsigned long nextRng(Rng *rng);
+double uniformRng(Rng *rng);
+
+#endif /* RNG_H */
@@ -1,7 +1,12 @@
 from setuptools import Extension, setup
 
 # Define the extension module
-module = Extension("mysymnmf", sources=['symnmfmodule.c'])
+module = Extension("mysymnmf", sources=['symnmfmodule.c'],
+                   # symnmfmodule.c includes these, so a change to any of them must rebuild it
+                   depends=[name + ext for name in ['symnmf', 'matrix', 'parallel', 'gemm', 'sparse', 'dataio',
+                                                    'rng', 'kmeans', 'smallk'] for ext in ['.c', '.h']],
+                   extra_compile_args=['-fopenmp'],  # Parallel row loops
+                   extra_link_args=['-fopenmp'])
 
 # Set up the package
 setup(
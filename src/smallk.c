@@ -0,0 +1,194 @@
+#include <stdlib.h>
+#include <string.h>
+#include "smallk.h"
+
+/* This C code generates kernels for an H with a fixed number of columns k,
+ * one set for every k from SMALL_K_MIN to SMALL_K_MAX. H is a tall n x k
+ * matrix, and with k known the loops over its rows have constant bounds:
+ * the compiler unrolls them and keeps a row of accumulators in registers,
+ * where the generic loops reload it for every entry. smallKernels picks the
+ * set for a k at runtime; callers fall back to their generic loop when it
+ * returns NULL. */
+
+#define DEFINE_SMALL_KERNELS(K) \
+\
+static void denseRow##K(const double *w, int depth, double alpha, const double *H, int ldh, double *out) { \
+    double acc[K]; \
+    int p, c; \
+\
+    for (c = 0; c < K; c++) { \
+        acc[c] = out[c]; \
+    } \
+    for (p = 0; p < depth; p++) { \
+        const double *row = H + (size_t)p * ldh; \
+        double scale = alpha * w[p]; \
+\
+        for (c = 0; c < K; c++) { \
+            acc[c] += scale * row[c]; \
+        } \
+    } \
+    for (c = 0; c < K; c++) { \
+        out[c] = acc[c]; \
+    } \
+} \
+\
+static void floatRow##K(const float *w, int depth, const double *H, int ldh, double *out) { \
+    double acc[K]; \
+    int p, c; \
+\
+    for (c = 0; c < K; c++) { \
+        acc[c] = out[c]; \
+    } \
+    for (p = 0; p < depth; p++) { \
+        const double *row = H + (size_t)p * ldh; \
+        double value = w[p]; \
+\
+        for (c = 0; c < K; c++) { \
+            acc[c] += value * row[c]; \
+        } \
+    } \
+    for (c = 0; c < K; c++) { \
+        out[c] = acc[c]; \
+    } \
+} \
+\
+static void sparseRow##K(const double *values, const int *cols, int count, const double *H, int ldh, \
+                         double *out) { \
+    double acc[K]; \
+    int e, c; \
+\
+    for (c = 0; c < K; c++) { \
+        acc[c] = out[c]; \
+    } \
+    for (e = 0; e < count; e++) { \
+        const double *row = H + (size_t)cols[e] * ldh; \
+        double scale = values[e]; \
+\
+        for (c = 0; c < K; c++) { \
+            acc[c] += scale * row[c]; \
+        } \
+    } \
+    for (c = 0; c < K; c++) { \
+        out[c] = acc[c]; \
+    } \
+} \
+\
+static void gram##K(const double *H, int ldh, int rows, double *gram, int ldg) { \
+    double acc[K][K]; \
+    int i, a, b; \
+\
+    memset(acc, 0, sizeof(acc)); \
+    for (i = 0; i < rows; i++) { \
+        const double *row = H + (size_t)i * ldh; \
+\
+        for (a = 0; a < K; a++) { \
+            double scale = row[a]; \
+\
+            for (b = a; b < K; b++) { \
+                acc[a][b] += scale * row[b]; \
+            } \
+        } \
+    } \
+    for (a = 0; a < K; a++) { \
+        for (b = 0; b < K; b++) { \
+            gram[(size_t)a * ldg + b] = (b >= a) ? acc[a][b] : acc[b][a]; \
+        } \
+    } \
+} \
+\
+static double updateRow##K(const double *current, const double *nom, const double *gram, int ldg, \
+                           int gradient, double step, double beta, double *updated, double *trace) { \
+    double denom, diff, sum = 0.0, dot = 0.0; \
+    int j, p; \
+\
+    for (j = 0; j < K; j++) { \
+        const double *column = gram + (size_t)j * ldg; \
+\
+        denom = 0.0; \
+        for (p = 0; p < K; p++) { \
+            denom += current[p] * column[p]; \
+        } \
+        if (gradient) { \
+            updated[j] = current[j] - step * (denom - nom[j]); \
+            updated[j] = (updated[j] > 0.0) ? updated[j] : 0.0; \
+        } \
+        else { \
+            updated[j] = current[j] * (1 - beta + beta * (nom[j] / denom)); \
+        } \
+        diff = updated[j] - current[j]; \
+        sum += diff * diff; \
+    } \
+    for (p = 0; p < K; p++) { \
+        dot += current[p] * nom[p]; \
+    } \
+    *trace = dot; \
+\
+    return sum; \
+} \
+\
+static int argmaxRow##K(const double *row) { \
+    int label = 0, j; \
+\
+    for (j = 1; j < K; j++) { \
+        if (row[j] > row[label]) { \
+            label = j; \
+        } \
+    } \
+\
+    return label; \
+}
+
+#define SMALL_KERNELS_ENTRY(K) \
+    {K, denseRow##K, floatRow##K, sparseRow##K, gram##K, updateRow##K, argmaxRow##K}
+
+DEFINE_SMALL_KERNELS(2)
+DEFINE_SMALL_KERNELS(3)
+DEFINE_SMALL_KERNELS(4)
+DEFINE_SMALL_KERNELS(5)
+DEFINE_SMALL_KERNELS(6)
+DEFINE_SMALL_KERNELS(7)
+DEFINE_SMALL_KERNELS(8)
+DEFINE_SMALL_KERNELS(9)
+DEFINE_SMALL_KERNELS(10)
+DEFINE_SMALL_KERNELS(11)
+DEFINE_SMALL_KERNELS(12)
+DEFINE_SMALL_KERNELS(13)
+DEFINE_SMALL_KERNELS(14)
+DEFINE_SMALL_KERNELS(15)
+DEFINE_SMALL_KERNELS(16)
+
+/* Entry k - SMALL_K_MIN holds the kernels for k columns. */
+static const SmallKernels smallKernelTable[SMALL_K_MAX - SMALL_K_MIN + 1] = {
+    SMALL_KERNELS_ENTRY(2), SMALL_KERNELS_ENTRY(3), SMALL_KERNELS_ENTRY(4), SMALL_KERNELS_ENTRY(5),
+    SMALL_KERNELS_ENTRY(6), SMALL_KERNELS_ENTRY(7), SMALL_KERNELS_ENTRY(8), SMALL_KERNELS_ENTRY(9),
+    SMALL_KERNELS_ENTRY(10), SMALL_KERNELS_ENTRY(11), SMALL_KERNELS_ENTRY(12), SMALL_KERNELS_ENTRY(13),
+    SMALL_KERNELS_ENTRY(14), SMALL_KERNELS_ENTRY(15), SMALL_KERNELS_ENTRY(16)
+};
+
+
+/* Function to get the kernels specialized for k columns.
+ * SYMNMF_SMALL_K is read on the first call only, so later calls, also from
+ * inside parallel regions, touch no environment.
+ * Return: const SmallKernels* - NULL if k is outside SMALL_K_MIN..SMALL_K_MAX
+ *         or SYMNMF_SMALL_K is "off"; the caller then uses its generic loop */
+const SmallKernels *smallKernels(int k) {
+    static int enabled = -1; /* Unknown until the first call reads the setting. */
+    const char *setting;
+    int known;
+
+#pragma omp atomic read
+    known = enabled;
+
+    if (known < 0) {
+        setting = getenv(SMALL_K_ENV_VAR);
+        known = !(setting != NULL && strcmp(setting, "off") == 0);
+#pragma omp atomic write
+        enabled = known;
+    }
+
+    if (!known || k < SMALL_K_MIN || k > SMALL_K_MAX) {
+        return NULL;
+    }
+
+    return &smallKernelTable[k - SMALL_K_MIN];
+}
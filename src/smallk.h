@@ -0,0 +1,34 @@
+#ifndef SMALLK_H
+#define SMALLK_H
+
+#define SMALL_K_MIN 2  /* Smallest number of clusters with specialized kernels. */
+#define SMALL_K_MAX 16 /* Largest number of clusters with specialized kernels. */
+#define SMALL_K_ENV_VAR "SYMNMF_SMALL_K" /* Set to "off" to use the generic loops for every k. */
+
+/* Define a structure for the kernels specialized for one number k of columns
+ * of H. Each is the generic loop it replaces with k fixed at compile time, so
+ * the loops over a row of H unroll and that row stays in registers. They add
+ * and compare in the same order as the generic loops, so they give the same
+ * results. H, ldh: the rows of H (n x k) and the stride between them. */
+typedef struct {
+    int k; /* Number of columns of H */
+
+    /* out += alpha * w * H for a dense row w of depth entries (out: one row of k) */
+    void (*denseRow)(const double *w, int depth, double alpha, const double *H, int ldh, double *out);
+    /* out += w * H for a single precision row w */
+    void (*floatRow)(const float *w, int depth, const double *H, int ldh, double *out);
+    /* out += w * H for a sparse row w of count entries values[e] in columns cols[e] */
+    void (*sparseRow)(const double *values, const int *cols, int count, const double *H, int ldh, double *out);
+    /* gram = transpose(H) * H, with rows rows of H; ldg is the stride of gram */
+    void (*gram)(const double *H, int ldh, int rows, double *gram, int ldg);
+    /* One row of updateStep: writes updated, sets *trace = current . nom and
+     * returns |updated - current|^2 */
+    double (*updateRow)(const double *current, const double *nom, const double *gram, int ldg,
+                        int gradient, double step, double beta, double *updated, double *trace);
+    /* Column of the largest entry of a row; the first one on ties */
+    int (*argmaxRow)(const double *row);
+} SmallKernels;
+
+const SmallKernels *smallKernels(int k);
+
+#endif /* SMALLK_H */
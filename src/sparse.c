@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "sparse.h"
+#include "parallel.h"
+#include "smallk.h"
+
+/* This C code defines functions for creating and operating on sparse
+ * matrices stored in compressed sparse row (CSR) form. */
+
+/* Function to allocate a sparse matrix with room for nnz entries.
+ * rowStart is zeroed; the caller fills in the structure. */
+SparseMatrix createSparseMatrix(int rows, int cols, int nnz) {
+    SparseMatrix matrix;
+
+    matrix.rows = rows;
+    matrix.cols = cols;
+    matrix.nnz = nnz;
+    matrix.rowStart = (int *)calloc((size_t)rows + 1, sizeof(int));
+    matrix.colIndex = (int *)malloc(((size_t)nnz + 1) * sizeof(int));
+    matrix.values = (double *)malloc(((size_t)nnz + 1) * sizeof(double));
+
+    if (matrix.rowStart == NULL || matrix.colIndex == NULL || matrix.values == NULL) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+    countAllocation(((size_t)rows + 1) * sizeof(int) + ((size_t)nnz + 1) * (sizeof(int) + sizeof(double)));
+
+    return matrix;
+}
+
+
+/* Function to free the memory allocated for a sparse matrix. */
+void freeSparseMatrix(SparseMatrix matrix) {
+    free(matrix.rowStart);
+    free(matrix.colIndex);
+    free(matrix.values);
+}
+
+
+/* Function to print a sparse matrix in the same format as printMatrix,
+ * writing the zeros between stored entries without storing them. */
+void printSparseMatrix(SparseMatrix matrix) {
+    int i, j, k;
+
+    for (i = 0; i < matrix.rows; i++) {
+        k = matrix.rowStart[i];
+
+        for (j = 0; j < matrix.cols; j++) {
+
+            if (k < matrix.rowStart[i + 1] && matrix.colIndex[k] == j) {
+                printf("%.4f", matrix.values[k]);
+                k++;
+            }
+            else {
+                printf("%.4f", 0.0);
+            }
+
+            if (j < matrix.cols - 1)
+                printf(",");
+            else
+                printf("\n");
+        }
+    }
+}
+
+
+/* Function to compute the sum of the entries in a specific row. */
+double sumSparseRow(SparseMatrix matrix, int row) {
+    double sum = 0.0;
+    int k;
+
+    for (k = matrix.rowStart[row]; k < matrix.rowStart[row + 1]; k++) {
+        sum += matrix.values[k];
+    }
+
+    return sum;
+}
+
+
+/* Function to compute the mean of all rows * cols entries, zeros included. */
+double meanSparseMatrix(SparseMatrix matrix) {
+    double sum = 0.0;
+    int k;
+
+    for (k = 0; k < matrix.nnz; k++) {
+        sum += matrix.values[k];
+    }
+
+    return sum / ((double)matrix.rows * matrix.cols);
+}
+
+
+/* Function to compute the sum of the squares of all entries, the squared Frobenius norm. */
+double squaredNormSparseMatrix(SparseMatrix matrix) {
+    double sum = 0.0;
+    int k;
+
+    for (k = 0; k < matrix.nnz; k++) {
+        sum += matrix.values[k] * matrix.values[k];
+    }
+
+    return sum;
+}
+
+
+/* Function to compute left * matrix * right for diagonal left and right.
+ * The result has the same sparsity structure as matrix. */
+SparseMatrix scaleDiagSparseMatrix(DiagMatrix left, SparseMatrix matrix, DiagMatrix right) {
+    SparseMatrix result;
+    int i, k;
+
+    if (left.size != matrix.rows || matrix.cols != right.size) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+    result = createSparseMatrix(matrix.rows, matrix.cols, matrix.nnz);
+    memcpy(result.rowStart, matrix.rowStart, ((size_t)matrix.rows + 1) * sizeof(int));
+    memcpy(result.colIndex, matrix.colIndex, (size_t)matrix.nnz * sizeof(int));
+
+#pragma omp parallel for num_threads(getNumThreads()) private(k)
+    for (i = 0; i < matrix.rows; i++) {
+
+        for (k = matrix.rowStart[i]; k < matrix.rowStart[i + 1]; k++) {
+            result.values[k] = left.values[i] * matrix.values[k] * right.values[matrix.colIndex[k]];
+        }
+    }
+
+    return result;
+}
+
+
+/* Function to compute result = matrix1 * matrix2 for a sparse matrix1 and a
+ * dense matrix2, in O(nnz * matrix2.cols). result must not alias matrix2. */
+void multiplySparseMatrixInto(SparseMatrix matrix1, Matrix matrix2, Matrix result) {
+    const SmallKernels *small = smallKernels(result.cols);
+    int i, j, k;
+
+    if (matrix1.cols != matrix2.rows || result.rows != matrix1.rows || result.cols != matrix2.cols) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+#pragma omp parallel for num_threads(getNumThreads()) private(j, k)
+    for (i = 0; i < matrix1.rows; i++) {
+        double *out = MATRIX_ROW(result, i);
+
+        for (j = 0; j < result.cols; j++) {
+            out[j] = 0.0;
+        }
+
+        if (small != NULL) {
+            k = matrix1.rowStart[i];
+            small->sparseRow(matrix1.values + k, matrix1.colIndex + k, matrix1.rowStart[i + 1] - k,
+                             matrix2.data, matrix2.stride, out);
+            continue;
+        }
+
+        for (k = matrix1.rowStart[i]; k < matrix1.rowStart[i + 1]; k++) {
+            double *row = MATRIX_ROW(matrix2, matrix1.colIndex[k]);
+            double scale = matrix1.values[k];
+
+            for (j = 0; j < result.cols; j++) {
+                out[j] += scale * row[j];
+            }
+        }
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef SPARSE_H
+#define SPARSE_H
+
+#include "matrix.h"
+
+/* Define a structure for a sparse matrix in compressed sparse row (CSR) form.
+ * The entries of row i are colIndex[k], values[k] for rowStart[i] <= k < rowStart[i + 1],
+ * with increasing column indices. */
+typedef struct {
+    int rows;       /* Number of rows in the matrix */
+    int cols;       /* Number of columns in the matrix */
+    int nnz;        /* Number of stored entries */
+    int *rowStart;  /* rows + 1 offsets into colIndex and values */
+    int *colIndex;  /* Column of each stored entry */
+    double *values; /* Value of each stored entry */
+} SparseMatrix;
+
+SparseMatrix createSparseMatrix(int rows, int cols, int nnz);
+void freeSparseMatrix(SparseMatrix matrix);
+void printSparseMatrix(SparseMatrix matrix);
+double sumSparseRow(SparseMatrix matrix, int row);
+double meanSparseMatrix(SparseMatrix matrix);
+double squaredNormSparseMatrix(SparseMatrix matrix);
+SparseMatrix scaleDiagSparseMatrix(DiagMatrix left, SparseMatrix matrix, DiagMatrix right);
+void multiplySparseMatrixInto(SparseMatrix matrix1, Matrix matrix2, Matrix result);
+
+#endif /* SPARSE_H */
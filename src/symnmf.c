@@ -1,319 +1,2669 @@
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L /* For mmap in dataio.c. */
+#endif
+
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
 
-#include "matrix.c"
-#include "matrix.h"
+#include "parallel.c"
+#include "smallk.c"
+#include "matrix.c"
+#include "gemm.c"
+#include "sparse.c"
+#include "dataio.c"
+#include "rng.c"
+#include "kmeans.c"
+#include "matrix.h"
+#include "smallk.h"
+#include "sparse.h"
+#include "dataio.h"
+#include "rng.h"
+#include "kmeans.h"
+#include "symnmf.h"
+
+#define SYM_BLOCK_SIZE 64 /* Rows per tile of the similarity matrix. */
+#define SYMKNN_DEFAULT_NEIGHBOURS 10 /* Neighbours per point for the symknn goal. */
+#define SYMNMF_DEFAULT_EPS 0.0001 /* Convergence threshold of the symnmf goal. */
+#define SYMNMF_DEFAULT_ITER 300 /* Maximum number of iterations of the symnmf goal. */
+#define SOLVER_DEFAULT_BETA 0.5 /* Damping of the multiplicative update. */
+#define SOLVER_DEFAULT_PATIENCE 10 /* Stable iterations before STOP_LABELS stops. */
+#define SOLVER_MIN_BETA 0.001 /* Smallest beta an adaptive solver shrinks to. */
+#define SOLVER_BETA_GROWTH 1.2 /* Growth of an adaptive beta per improving iteration. */
+#define IMPLICIT_BLOCK_COLS 1024 /* Columns per block of an implicit W; see ImplicitWeights. */
+#ifndef OUT_OF_CORE_TILE_BYTES
+#define OUT_OF_CORE_TILE_BYTES (64L << 20) /* Size of a row tile of an out-of-core matrix. */
+#endif
+
+
+/* 
+ * Function to compute the squared norm of every data point 
+ * Input: X - data matrix (n x d)
+ * Return: double* - n squared norms; release with free
+ */
+double *squaredNorms(Matrix X){
+    double *norms, *currentVector;
+    int current;
+
+    norms = (double *)malloc(((size_t)X.rows + 1) * sizeof(double));
+
+    if (norms == NULL) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+#pragma omp parallel for num_threads(getNumThreads()) private(currentVector)
+    for (current = 0; current < X.rows; current++){
+        currentVector = MATRIX_ROW(X, current);
+        norms[current] = dotProduct(currentVector, currentVector, X.cols);
+    }
+
+    return norms;
+}
+
+
+/* 
+ * Function to copy the data points with their mean subtracted 
+ * ||x||^2 + ||y||^2 - 2 x.y cancels badly for points far from the origin,
+ * and distances do not change under translation, so the paths that use it
+ * work on centered data.
+ * Input: X - data matrix (n x d)
+ * Return: Matrix - centered copy of X (n x d); release with freeMatrix
+ */
+Matrix centerData(Matrix X){
+    Matrix centered = createZeroMatrix(X.rows, X.cols);
+    double *means;
+    int current, j;
+
+    means = (double *)calloc((size_t)X.cols + 1, sizeof(double));
+    if (means == NULL) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+    for (current = 0; current < X.rows; current++){
+        for (j = 0; j < X.cols; j++){
+            means[j] += MATRIX_AT(X, current, j);
+        }
+    }
+    for (j = 0; j < X.cols; j++){
+        means[j] /= (X.rows > 0) ? X.rows : 1;
+    }
+
+#pragma omp parallel for num_threads(getNumThreads()) private(j)
+    for (current = 0; current < X.rows; current++){
+        for (j = 0; j < X.cols; j++){
+            MATRIX_AT(centered, current, j) = MATRIX_AT(X, current, j) - means[j];
+        }
+    }
+
+    free(means);
+
+    return centered;
+}
+
+
+/* Function to compute the entries colStart to colStart + cols - 1 of row
+ * row of the similarity matrix into out, on the calling thread; see symBlock. */
+static void symBlockRow(Matrix X, const double *norms, int row, int colStart, double *out, int cols){
+    double *currentVector = MATRIX_ROW(X, row);
+    double distance;
+    int other;
+
+    for (other = 0; other < cols; other++){
+        distance = norms[row] + norms[colStart + other]
+                   - 2 * dotProduct(currentVector, MATRIX_ROW(X, colStart + other), X.cols);
+        out[other] = (distance > 0.0) ? (distance / -2) : 0.0;
+    }
+
+    vectorExp(out, cols);
+
+    /* A point is not similar to itself. */
+    if (row >= colStart && row < colStart + cols){
+        out[row - colStart] = 0.0;
+    }
+}
+
+
+/* 
+ * Function to compute one block of the similarity matrix 
+ * Entries are computed exactly as in sym, so a matrix assembled from blocks
+ * equals sym(X).
+ * Input: X - data matrix (n x d), centered; see centerData
+ *        norms - squared norms of the data points; see squaredNorms
+ *        rowStart, colStart - position of the block's first entry in A
+ *        block - output; may be a view into a larger matrix
+ */
+void symBlock(Matrix X, const double *norms, int rowStart, int colStart, Matrix block){
+    int current;
+
+#pragma omp parallel for num_threads(getNumThreads())
+    for (current = 0; current < block.rows; current++){
+        symBlockRow(X, norms, rowStart + current, colStart, MATRIX_ROW(block, current), block.cols);
+    }
+}
+
+
+/* 
+ * Function to compute the similarity matrix into double or single precision storage 
+ * A is symmetric, so only the blocks on and above the diagonal are computed
+ * and each value is mirrored. Distances use ||x||^2 + ||y||^2 - 2 x.y, and
+ * each row segment of a block goes through exp in one batch, in double
+ * precision, before it is stored.
+ * Input: X - data matrix (n x d)
+ *        A - output (n x n) for double precision, or NULL
+ *        A_single - output (n x n) for single precision, used when A is NULL
+ */
+static void fillSym(Matrix X, Matrix *A, FloatMatrix *A_single){
+    double segment[SYM_BLOCK_SIZE];
+    double *norms, *currentVector;
+    int blockStart, otherStart, blockEnd, otherEnd;
+    int current, other, first;
+    double distance;
+    Matrix centered = centerData(X);
+
+    norms = squaredNorms(centered);
+
+    /* Tile rows get shorter towards the bottom, so they are handed out dynamically. */
+#pragma omp parallel for num_threads(getNumThreads()) schedule(dynamic) \
+    private(segment, otherStart, blockEnd, otherEnd, current, other, first, distance, currentVector)
+    for (blockStart = 0; blockStart < X.rows; blockStart += SYM_BLOCK_SIZE){
+        blockEnd = (blockStart + SYM_BLOCK_SIZE < X.rows) ? blockStart + SYM_BLOCK_SIZE : X.rows;
+
+        for (otherStart = blockStart; otherStart < X.rows; otherStart += SYM_BLOCK_SIZE){
+            otherEnd = (otherStart + SYM_BLOCK_SIZE < X.rows) ? otherStart + SYM_BLOCK_SIZE : X.rows;
+
+            for (current = blockStart; current < blockEnd; current++){
+                currentVector = MATRIX_ROW(centered, current);
+                first = (otherStart == blockStart) ? current + 1 : otherStart;
+
+                for (other = first; other < otherEnd; other++){
+                    distance = norms[current] + norms[other]
+                               - 2 * dotProduct(currentVector, MATRIX_ROW(centered, other), X.cols);
+                    segment[other - otherStart] = (distance > 0.0) ? (distance / -2) : 0.0;
+                }
+
+                vectorExp(segment + (first - otherStart), otherEnd - first);
+
+                for (other = first; other < otherEnd; other++){
+                    if (A != NULL){
+                        MATRIX_AT(*A, current, other) = segment[other - otherStart];
+                        MATRIX_AT(*A, other, current) = segment[other - otherStart];
+                    }
+                    else{
+                        MATRIX_AT(*A_single, current, other) = (float)segment[other - otherStart];
+                        MATRIX_AT(*A_single, other, current) = (float)segment[other - otherStart];
+                    }
+                }
+            }
+        }
+    }
+
+    free(norms);
+    freeMatrix(centered);
+}
+
+
+/* 
+ * Function to compute the similarity matrix 
+ * Input: X - data matrix (n x d)
+ * Return: Matrix - similarity matrix (n x n)
+ */
+Matrix sym(Matrix X){
+    Matrix A = createZeroMatrix(X.rows, X.rows);
+
+    fillSym(X, &A, NULL);
+
+    return A;
+}
+
+
+/* 
+ * Function to compute the similarity matrix in single precision storage 
+ * Input: X - data matrix (n x d)
+ * Return: FloatMatrix - similarity matrix (n x n)
+ */
+FloatMatrix symSingle(Matrix X){
+    FloatMatrix A = createFloatMatrix(X.rows, X.rows);
+
+    fillSym(X, NULL, &A);
+
+    return A;
+}
+
+
+/* 
+ * Function to compute the diagonal degree matrix 
+ * Input: A - similarity matrix (n x n)
+ * Return: DiagMatrix - diagonal degree matrix (n x n), stored as its diagonal
+ */
+DiagMatrix ddg(Matrix A){
+    int diag;
+    DiagMatrix D;
+
+    D = createDiagMatrix(A.rows);
+
+#pragma omp parallel for num_threads(getNumThreads())
+    for (diag = 0; diag < A.rows; diag++){
+        D.values[diag] = sumRow(A, diag);
+    }
+
+    return D;
+}
+
+/* 
+ * Function to compute the normalized Laplacian matrix 
+ * Input: D - diagonal degree matrix (n x n)
+ *        A - similarity matrix (n x n)
+ * Return: Matrix - normalized Laplacian matrix (n x n)
+ */
+Matrix norm(DiagMatrix D, Matrix A){
+    Matrix W = createZeroMatrix(A.rows, A.cols);
+
+    normInto(D, A, W);
+
+    return W;
+}
+
+
+/* 
+ * Function to compute the normalized Laplacian matrix into existing storage 
+ * Input: D - diagonal degree matrix (n x n)
+ *        A - similarity matrix (n x n)
+ *        W - output (n x n); may be A, which turns A into W without a
+ *            second n x n matrix
+ */
+void normInto(DiagMatrix D, Matrix A, Matrix W){
+    DiagMatrix T = powerDiagMatrix(D, (-0.5));
+
+    scaleDiagMatrixInto(T, A, T, W);
+
+    freeDiagMatrix(T);
+}
+
+
+/* 
+ * Function to compute the diagonal degree matrix of a single precision
+ * similarity matrix; the degrees are summed in double precision 
+ * Input: A - similarity matrix (n x n)
+ * Return: DiagMatrix - diagonal degree matrix (n x n), stored as its diagonal
+ */
+DiagMatrix ddgSingle(FloatMatrix A){
+    int diag;
+    DiagMatrix D;
+
+    D = createDiagMatrix(A.rows);
+
+#pragma omp parallel for num_threads(getNumThreads())
+    for (diag = 0; diag < A.rows; diag++){
+        D.values[diag] = sumFloatRow(A, diag);
+    }
+
+    return D;
+}
+
+
+/* 
+ * Function to compute the normalized similarity matrix in single precision storage 
+ * A is scaled in place, so no second n x n matrix is allocated.
+ * Input: D - diagonal degree matrix (n x n)
+ *        A - similarity matrix (n x n); overwritten
+ * Return: FloatMatrix - normalized similarity matrix (n x n), in A's storage
+ */
+FloatMatrix normSingle(DiagMatrix D, FloatMatrix A){
+    DiagMatrix T;
+
+    T = powerDiagMatrix(D, (-0.5));
+    scaleDiagFloatMatrix(T, A, T);
+
+    freeDiagMatrix(T);
+
+    return A;
+}
+
+
+/* Function to choose how many rows of an n x cols matrix make one
+ * out-of-core tile, about OUT_OF_CORE_TILE_BYTES each. */
+static int outOfCoreTileRows(int rows, int cols){
+    long tileRows = OUT_OF_CORE_TILE_BYTES / ((long)cols * (long)sizeof(double) + 1);
+
+    tileRows = (tileRows < 1) ? 1 : tileRows;
+    return (tileRows < rows) ? (int)tileRows : rows;
+}
+
+
+/* 
+ * Function to compute the diagonal degree matrix without storing A 
+ * A is computed one tile of rows at a time and only its row sums are kept,
+ * so memory use is one tile (see OUT_OF_CORE_TILE_BYTES) however large n is.
+ * Input: X - data matrix (n x d)
+ * Return: DiagMatrix - diagonal degree matrix (n x n), equal to ddg(sym(X))
+ */
+DiagMatrix ddgTiled(Matrix X){
+    int tileRows = outOfCoreTileRows(X.rows, X.rows);
+    Matrix tile = createZeroMatrix(tileRows, X.rows);
+    Matrix centered = centerData(X);
+    double *norms = squaredNorms(centered);
+    DiagMatrix D = createDiagMatrix(X.rows);
+    Matrix view;
+    int start, row;
+
+    for (start = 0; start < X.rows; start += tileRows){
+        view = rowRange(tile, 0, (start + tileRows < X.rows) ? tileRows : X.rows - start);
+        symBlock(centered, norms, start, 0, view);
+
+#pragma omp parallel for num_threads(getNumThreads())
+        for (row = 0; row < view.rows; row++){
+            D.values[start + row] = sumRow(view, row);
+        }
+    }
+
+    free(norms);
+    freeMatrix(centered);
+    freeMatrix(tile);
+
+    return D;
+}
+
+
+/* 
+ * Function to compute the similarity matrix, or the normalized one, into a
+ * scratch file instead of memory 
+ * Rows are computed one tile at a time straight into the file mapping, so
+ * memory use does not grow with n^2; the kernel writes finished tiles back
+ * to disk as it needs the memory. Each tile computes its entries on and
+ * above the diagonal and mirrors them into the rows below, and the degrees
+ * are summed on the way in column order, as ddg sums a row. W is then
+ * scaled in place in a second pass over the file.
+ * Input: X - data matrix (n x d)
+ *        normalize - 1 for the normalized matrix W, 0 for A
+ *        scratchFile - path of the scratch file; see createScratchMatrix
+ *        result - output; release with unmapMatrixFile
+ * Return: int - 0 on success, 1 if the scratch file cannot be created
+ */
+int symOutOfCore(Matrix X, int normalize, const char *scratchFile, MappedMatrix *result){
+    int tileRows = outOfCoreTileRows(X.rows, X.rows);
+    double *norms, *values;
+    DiagMatrix D, T;
+    Matrix A, centered, view;
+    int start, end, row, other;
+    double sum;
+
+    if (createScratchMatrix(scratchFile, X.rows, X.rows, result) != 0){
+        return 1;
+    }
+
+    A = result->matrix;
+    centered = centerData(X);
+    norms = squaredNorms(centered);
+    D = createDiagMatrix(normalize ? X.rows : 0);
+
+    for (start = 0; start < X.rows; start += tileRows){
+        end = (start + tileRows < X.rows) ? start + tileRows : X.rows;
+
+#pragma omp parallel for num_threads(getNumThreads()) schedule(dynamic)
+        for (row = start; row < end; row++){
+            symBlockRow(centered, norms, row, row, &MATRIX_AT(A, row, row), X.rows - row);
+        }
+
+        /* Each later row takes its entries in the tile's columns, and adds
+         * them to its degree after the ones of the earlier tiles. */
+#pragma omp parallel for num_threads(getNumThreads()) private(other, sum)
+        for (row = start + 1; row < X.rows; row++){
+            sum = normalize ? D.values[row] : 0.0;
+            for (other = start; other < end && other < row; other++){
+                MATRIX_AT(A, row, other) = MATRIX_AT(A, other, row);
+                sum += MATRIX_AT(A, row, other);
+            }
+            if (normalize){
+                D.values[row] = sum;
+            }
+        }
+
+        if (normalize){
+#pragma omp parallel for num_threads(getNumThreads()) private(other, sum, values)
+            for (row = start; row < end; row++){
+                values = MATRIX_ROW(A, row);
+                sum = D.values[row];
+                for (other = row; other < X.rows; other++){
+                    sum += values[other];
+                }
+                D.values[row] = sum;
+            }
+        }
+    }
+
+    /* Scaled in place as norm does, so the result equals norm(D, A). */
+    if (normalize){
+        T = powerDiagMatrix(D, (-0.5));
+        for (start = 0; start < X.rows; start += tileRows){
+            view = rowRange(A, start, (start + tileRows < X.rows) ? tileRows : X.rows - start);
+            scaleDiagMatrixInto(diagRange(T, start, view.rows), view, T, view);
+        }
+        freeDiagMatrix(T);
+    }
+
+    freeDiagMatrix(D);
+    free(norms);
+    freeMatrix(centered);
+
+    return 0;
+}
+
+
+/* One directed edge of the sparse similarity graph, used while building it. */
+typedef struct {
+    int row;
+    int col;
+    double value;
+} GraphEdge;
+
+
+/* Function to order graph edges by row, then by column, for qsort. */
+static int compareGraphEdges(const void *first, const void *second) {
+    const GraphEdge *edge1 = (const GraphEdge *)first;
+    const GraphEdge *edge2 = (const GraphEdge *)second;
+
+    if (edge1->row != edge2->row) {
+        return (edge1->row < edge2->row) ? -1 : 1;
+    }
+    if (edge1->col != edge2->col) {
+        return (edge1->col < edge2->col) ? -1 : 1;
+    }
+    return 0;
+}
+
+
+/* 
+ * Function to build the symmetric k-nearest-neighbour similarity graph 
+ * Each point selects its neighbours closest points (ties go to the lower
+ * index); the edge (i, j) is kept if either endpoint selected the other.
+ * Input: X - data matrix (n x d)
+ *        neighbours - number of neighbours per point
+ * Return: SparseMatrix - similarity graph (n x n)
+ */
+static SparseMatrix symNeighbours(Matrix X, int neighbours){
+    GraphEdge *edges, *mine;
+    int current, other, count, slot, unique, k;
+    double distance;
+    size_t total;
+    SparseMatrix A;
+
+    neighbours = (neighbours < X.rows - 1) ? neighbours : X.rows - 1;
+    neighbours = (neighbours > 0) ? neighbours : 0;
+    total = 2 * (size_t)X.rows * neighbours;
+
+    edges = (GraphEdge *)malloc((total + 1) * sizeof(GraphEdge));
+    if (edges == NULL) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+    /* The selected neighbours of a point are kept sorted by distance in its
+     * own slice of edges, with the distance in value. */
+#pragma omp parallel for num_threads(getNumThreads()) schedule(dynamic, 16) \
+    private(mine, other, count, slot, distance)
+    for (current = 0; current < X.rows; current++){
+        mine = edges + 2 * (size_t)current * neighbours;
+        count = 0;
+
+        for (other = 0; other < X.rows; other++){
+
+            if (other == current){
+                continue;
+            }
+
+            distance = squaredEuclideanDistance(MATRIX_ROW(X, current), MATRIX_ROW(X, other), X.cols);
+
+            if (count == neighbours && (neighbours == 0 || distance >= mine[count - 1].value)){
+                continue;
+            }
+
+            slot = (count < neighbours) ? count++ : count - 1;
+
+            while (slot > 0 && mine[slot - 1].value > distance){
+                mine[slot] = mine[slot - 1];
+                slot--;
+            }
+
+            mine[slot].col = other;
+            mine[slot].value = distance;
+        }
+
+        /* Store each selected edge in both directions. */
+        for (slot = 0; slot < neighbours; slot++){
+            mine[slot].row = current;
+            mine[slot].value = exp(mine[slot].value / -2);
+            mine[neighbours + slot].row = mine[slot].col;
+            mine[neighbours + slot].col = current;
+            mine[neighbours + slot].value = mine[slot].value;
+        }
+    }
+
+    qsort(edges, total, sizeof(GraphEdge), compareGraphEdges);
+
+    unique = 0;
+    for (k = 0; k < (int)total; k++){
+        if (k == 0 || compareGraphEdges(&edges[k - 1], &edges[k]) != 0){
+            edges[unique++] = edges[k];
+        }
+    }
+
+    A = createSparseMatrix(X.rows, X.rows, unique);
+
+    for (k = 0; k < unique; k++){
+        A.rowStart[edges[k].row + 1]++;
+        A.colIndex[k] = edges[k].col;
+        A.values[k] = edges[k].value;
+    }
+
+    for (current = 0; current < X.rows; current++){
+        A.rowStart[current + 1] += A.rowStart[current];
+    }
+
+    free(edges);
+
+    return A;
+}
+
+
+/* 
+ * Function to build the epsilon-radius similarity graph 
+ * The graph is symmetric, so as in fillSym each distance is computed once,
+ * above the diagonal, and mirrored. A tile of rows (see outOfCoreTileRows)
+ * holds the distances until the entries within radius are appended to the
+ * upper triangle; the rows of the graph are then assembled from it in
+ * column order.
+ * Input: X - data matrix (n x d)
+ *        radius - points closer than radius are linked
+ * Return: SparseMatrix - similarity graph (n x n)
+ */
+static SparseMatrix symRadius(Matrix X, double radius){
+    double limit = radius * radius;
+    int tileRows = outOfCoreTileRows(X.rows, X.rows);
+    Matrix tile = createZeroMatrix(tileRows, X.rows);
+    int *upperStart, *upperCols, *cursor;
+    double *upperValues, *distances;
+    size_t capacity = 0;
+    int start, end, current, other, k;
+    SparseMatrix A;
+
+    upperStart = (int *)calloc((size_t)X.rows + 1, sizeof(int));
+    cursor = (int *)calloc((size_t)X.rows + 1, sizeof(int));
+    upperCols = (int *)malloc(sizeof(int));
+    upperValues = (double *)malloc(sizeof(double));
+    if (upperStart == NULL || cursor == NULL || upperCols == NULL || upperValues == NULL) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+    for (start = 0; start < X.rows; start += tileRows){
+        end = (start + tileRows < X.rows) ? start + tileRows : X.rows;
+
+        /* Tile rows get shorter towards the bottom, so they are handed out dynamically. */
+#pragma omp parallel for num_threads(getNumThreads()) schedule(dynamic) private(other, k, distances)
+        for (current = start; current < end; current++){
+            distances = MATRIX_ROW(tile, current - start);
+            k = 0;
+
+            for (other = current + 1; other < X.rows; other++){
+                distances[other] = squaredEuclideanDistance(MATRIX_ROW(X, current), MATRIX_ROW(X, other), X.cols);
+                k += (distances[other] <= limit);
+            }
+            upperStart[current + 1] = k;
+        }
+
+        for (current = start; current < end; current++){
+            upperStart[current + 1] += upperStart[current];
+        }
+
+        if ((size_t)upperStart[end] > capacity) {
+            capacity = (2 * capacity > (size_t)upperStart[end]) ? 2 * capacity : (size_t)upperStart[end];
+            upperCols = (int *)realloc(upperCols, capacity * sizeof(int));
+            upperValues = (double *)realloc(upperValues, capacity * sizeof(double));
+
+            if (upperCols == NULL || upperValues == NULL) {
+                printf("An Error Has Occurred");
+                exit(1);
+            }
+        }
+
+#pragma omp parallel for num_threads(getNumThreads()) private(other, k, distances)
+        for (current = start; current < end; current++){
+            distances = MATRIX_ROW(tile, current - start);
+            k = upperStart[current];
+
+            for (other = current + 1; other < X.rows; other++){
+                if (distances[other] <= limit){
+                    upperCols[k] = other;
+                    upperValues[k] = exp(distances[other] / -2);
+                    k++;
+                }
+            }
+        }
+    }
+
+    freeMatrix(tile);
+
+    /* A row holds the entries of its column above the diagonal, then its own. */
+    for (k = 0; k < upperStart[X.rows]; k++){
+        cursor[upperCols[k]]++;
+    }
+
+    A = createSparseMatrix(X.rows, X.rows, 2 * upperStart[X.rows]);
+    for (current = 0; current < X.rows; current++){
+        A.rowStart[current + 1] = A.rowStart[current] + cursor[current]
+                                  + (upperStart[current + 1] - upperStart[current]);
+        cursor[current] = A.rowStart[current];
+    }
+
+    /* Rows are mirrored in order, so the entries of each row arrive by column. */
+    for (current = 0; current < X.rows; current++){
+        for (k = upperStart[current]; k < upperStart[current + 1]; k++){
+            other = upperCols[k];
+            A.colIndex[cursor[other]] = current;
+            A.values[cursor[other]] = upperValues[k];
+            cursor[other]++;
+        }
+    }
+
+#pragma omp parallel for num_threads(getNumThreads()) private(k)
+    for (current = 0; current < X.rows; current++){
+        for (k = upperStart[current]; k < upperStart[current + 1]; k++){
+            A.colIndex[cursor[current]] = upperCols[k];
+            A.values[cursor[current]] = upperValues[k];
+            cursor[current]++;
+        }
+    }
+
+    free(upperStart);
+    free(upperCols);
+    free(upperValues);
+    free(cursor);
+
+    return A;
+}
+
+
+/* 
+ * Function to compute the sparse similarity graph (symknn goal) 
+ * Edge weights are the Gaussian similarities of sym, so the graph of all
+ * n - 1 neighbours is exactly sym(X).
+ * Input: X - data matrix (n x d)
+ *        neighbours - number of nearest neighbours per point
+ *        radius - if positive, link every pair closer than radius instead
+ * Return: SparseMatrix - similarity graph (n x n)
+ */
+SparseMatrix symKnn(Matrix X, int neighbours, double radius){
+
+    if (radius > 0.0){
+        return symRadius(X, radius);
+    }
+
+    return symNeighbours(X, neighbours);
+}
+
+
+/* 
+ * Function to compute the diagonal degree matrix of a sparse graph 
+ * Input: A - sparse similarity matrix (n x n)
+ * Return: DiagMatrix - diagonal degree matrix (n x n), stored as its diagonal
+ */
+DiagMatrix ddgSparse(SparseMatrix A){
+    int diag;
+    DiagMatrix D;
+
+    D = createDiagMatrix(A.rows);
+
+#pragma omp parallel for num_threads(getNumThreads())
+    for (diag = 0; diag < A.rows; diag++){
+        D.values[diag] = sumSparseRow(A, diag);
+    }
+
+    return D;
+}
+
+
+/* 
+ * Function to compute the normalized similarity matrix of a sparse graph 
+ * Input: D - diagonal degree matrix (n x n)
+ *        A - sparse similarity matrix (n x n)
+ * Return: SparseMatrix - normalized similarity matrix, with the structure of A
+ */
+SparseMatrix normSparse(DiagMatrix D, SparseMatrix A){
+    DiagMatrix T;
+    SparseMatrix W;
+
+    T = powerDiagMatrix(D, (-0.5));
+    W = scaleDiagSparseMatrix(T, A, T);
+
+    freeDiagMatrix(T);
+
+    return W;
+}
+
+/* 
+ * Python wrapper function for different goals:
+ * Input: goal - goal type:
+            i. sym: Calculate and output the Similarity Matrix
+            ii. ddg: Calculate and output the Diagonal Degree Matrix
+            iii. norm: Calculate and output the Normalized Similarity Matrix
+ *        fileName - name of the file containing the data
+ * Return: Matrix - the result based on the specified goal.
+ *         For ddg this is the degree vector, as an n x 1 matrix.
+ */
+Matrix symnmf(char *goal, char *fileName){
+    Matrix X;
+    Matrix A;
+    DiagMatrix D;
+    Matrix W;
+
+    X = loadData(fileName);
+
+    if (strcmp(goal,"sym") == 0){
+        A = sym(X);
+        freeMatrix(X);  
+        return A;
+    }
+    if (strcmp(goal,"ddg") == 0){
+        A = sym(X);
+        D = ddg(A);
+        W = createMatrix(D.size, 1, D.values);
+        freeMatrix(X);  
+        freeMatrix(A);  
+        freeDiagMatrix(D);  
+        return W;
+    }
+    if (strcmp(goal,"norm") == 0){
+        W = sym(X);
+        D = ddg(W);
+        normInto(D, W, W);
+        freeMatrix(X);  
+        freeDiagMatrix(D);  
+        return W;
+    }
+
+    freeMatrix(X);
+    return X;
+}
+
+
+/* Function to get the bytes the buffers of an UpdateWorkspace for an n x k H take. */
+size_t updateWorkspaceBytes(int n, int k) {
+    return matrixBytes(k, k, sizeof(double)) + 3 * matrixBytes(n, k, sizeof(double)) +
+           2 * matrixBytes(1, n, sizeof(double));
+}
+
+
+/* Function to carve the buffers of an UpdateWorkspace for an n x k H out of
+ * an arena with updateWorkspaceBytes(n, k) bytes to spare. */
+static UpdateWorkspace carveUpdateWorkspace(Arena *arena, int n, int k) {
+    UpdateWorkspace workspace;
+
+    workspace.gram = arenaMatrix(arena, k, k);
+    workspace.nominator = arenaMatrix(arena, n, k);
+    workspace.buffers[0] = arenaMatrix(arena, n, k);
+    workspace.buffers[1] = arenaMatrix(arena, n, k);
+    workspace.rowDiffs = arenaMatrix(arena, 1, n).data;
+    workspace.rowTraces = arenaMatrix(arena, 1, n).data;
+    memset(&workspace.arena, 0, sizeof(Arena));
+
+    return workspace;
+}
+
+
+/* 
+ * Function to allocate the buffers used by the iterations of converge_H 
+ * Input: n - number of data points
+ *        k - number of clusters
+ * Return: UpdateWorkspace - buffers for an n x k H, in one arena
+ */
+UpdateWorkspace createUpdateWorkspace(int n, int k) {
+    Arena arena = createArena(updateWorkspaceBytes(n, k));
+    UpdateWorkspace workspace = carveUpdateWorkspace(&arena, n, k);
+
+    workspace.arena = arena;
+
+    return workspace;
+}
+
+
+/* Function to free the buffers of an UpdateWorkspace. */
+void freeUpdateWorkspace(UpdateWorkspace workspace) {
+    freeArena(workspace.arena);
+}
+
+
+/* Function to compute result = W * H for a dense W. */
+void denseWeightProduct(const void *weights, Matrix H, Matrix result) {
+    gemm(1.0, *(const Matrix *)weights, H, 0.0, result);
+}
+
+
+/* Function to compute result = W * H for a single precision W. */
+void singleWeightProduct(const void *weights, Matrix H, Matrix result) {
+    multiplyFloatMatrixInto(*(const FloatMatrix *)weights, H, result);
+}
+
+
+/* Function to compute result = W * H for a W kept in a scratch file, one
+ * tile of rows at a time. The next tile is read in the background while the
+ * current one is multiplied, so disk reads overlap the arithmetic. */
+void streamedWeightProduct(const void *weights, Matrix H, Matrix result) {
+    Matrix W = *(const Matrix *)weights;
+    int tileRows = outOfCoreTileRows(W.rows, W.cols);
+    Matrix tile = W, resultTile = result;
+    int start, end;
+
+    prefetchMatrixRows(W, 0, tileRows);
+
+    for (start = 0; start < W.rows; start = end) {
+        end = (start + tileRows < W.rows) ? start + tileRows : W.rows;
+        prefetchMatrixRows(W, end, (end + tileRows < W.rows) ? end + tileRows : W.rows);
+
+        tile.rows = resultTile.rows = end - start;
+        tile.data = MATRIX_ROW(W, start);
+        resultTile.data = MATRIX_ROW(result, start);
+        gemm(1.0, tile, H, 0.0, resultTile);
+    }
+}
+
+
+/* 
+ * Function to describe the normalized similarity matrix W without storing it 
+ * Only the centered data, the squared norms and D^-1/2 are kept: O(nd)
+ * memory.
+ * Input: X - data matrix (n x d)
+ * Return: ImplicitWeights - W for implicitWeightProduct; release with
+ *         freeImplicitWeights
+ */
+ImplicitWeights createImplicitWeights(Matrix X) {
+    ImplicitWeights weights;
+    DiagMatrix D = ddgTiled(X);
+
+    weights.X = centerData(X);
+    weights.norms = squaredNorms(weights.X);
+    weights.scale = powerDiagMatrix(D, (-0.5));
+    freeDiagMatrix(D);
+
+    return weights;
+}
+
+
+/* Function to free the memory allocated for an ImplicitWeights. */
+void freeImplicitWeights(ImplicitWeights weights) {
+    freeMatrix(weights.X);
+    free(weights.norms);
+    freeDiagMatrix(weights.scale);
+}
+
+
+/* 
+ * Function to compute result = W * H for an implicit W 
+ * W is recomputed block by block from the data, each block multiplied into
+ * its rows of the result and then discarded, so every product costs the
+ * O(n^2 d) work of sym again but needs only one small block per thread.
+ * Blocks of a row are always added in the same order, so the result does
+ * not depend on the number of threads.
+ * Input: weights - ImplicitWeights describing W (n x n)
+ *        H - matrix (n x k)
+ *        result - output (n x k)
+ */
+void implicitWeightProduct(const void *weights, Matrix H, Matrix result) {
+    const ImplicitWeights *W = (const ImplicitWeights *)weights;
+    int n = W->X.rows;
+    int rowStart;
+
+#pragma omp parallel num_threads(getNumThreads())
+    {
+        Matrix block = createZeroMatrix(SYM_BLOCK_SIZE, IMPLICIT_BLOCK_COLS);
+        Matrix view, resultRows;
+        double *out;
+        int colStart, rowCount, colCount, i, j;
+
+#pragma omp for schedule(dynamic)
+        for (rowStart = 0; rowStart < n; rowStart += SYM_BLOCK_SIZE) {
+            rowCount = (rowStart + SYM_BLOCK_SIZE < n) ? SYM_BLOCK_SIZE : n - rowStart;
+            resultRows = rowRange(result, rowStart, rowCount);
+
+            for (colStart = 0; colStart < n; colStart += IMPLICIT_BLOCK_COLS) {
+                colCount = (colStart + IMPLICIT_BLOCK_COLS < n) ? IMPLICIT_BLOCK_COLS : n - colStart;
+                view = columnRange(rowRange(block, 0, rowCount), 0, colCount);
+
+                /* Each thread computes its blocks alone: the rows of symBlock and
+                 * scaleDiagMatrixInto, then gemmSerial, open no nested parallel regions. */
+                for (i = 0; i < rowCount; i++) {
+                    out = MATRIX_ROW(view, i);
+                    symBlockRow(W->X, W->norms, rowStart + i, colStart, out, colCount);
+                    for (j = 0; j < colCount; j++) {
+                        out[j] = W->scale.values[rowStart + i] * out[j] * W->scale.values[colStart + j];
+                    }
+                }
+
+                gemmSerial(1.0, view, rowRange(H, colStart, colCount), (colStart == 0) ? 0.0 : 1.0, resultRows);
+            }
+        }
+
+        freeMatrix(block);
+    }
+}
+
+
+/* Function to compute the mean of all entries of an implicit W, from its row sums W * 1. */
+double meanImplicitWeights(ImplicitWeights weights) {
+    Matrix ones = createZeroMatrix(weights.X.rows, 1);
+    Matrix rowSums = createZeroMatrix(weights.X.rows, 1);
+    double mean;
+    int i;
+
+    for (i = 0; i < ones.rows; i++) {
+        MATRIX_AT(ones, i, 0) = 1.0;
+    }
+
+    implicitWeightProduct(&weights, ones, rowSums);
+    mean = sumColumn(rowSums, 0) / ((double)weights.X.rows * weights.X.rows);
+
+    freeMatrix(ones);
+    freeMatrix(rowSums);
+
+    return mean;
+}
+
+
+/* Function to compute result = W * H for a sparse W. */
+void sparseWeightProduct(const void *weights, Matrix H, Matrix result) {
+    multiplySparseMatrixInto(*(const SparseMatrix *)weights, H, result);
+}
+
+
+/* 
+ * Function to write one step of a solver from H_current into H_new 
+ * The multiplicative rules set H_new = H_current * (1 - beta + beta * WH / HHtH)
+ * element-wise; SOLVER_PROJECTED_GRADIENT sets H_new = max(0, H_current -
+ * step * (HHtH - WH)), where step = beta / (3 * |HtH| + 1) bounds the
+ * curvature of the objective. Row i of H_current times row i of W * H is
+ * kept in workspace->rowTraces; see stepObjective.
+ * Input: H_current - current H matrix (n x k)
+ *        workspace - its nominator must already hold W * H_current
+ *        solver, beta - the rule and its damping or step scale
+ *        H_new - output matrix (n x k); must not be H_current
+ * Return: double - Frobenius norm of H_new - H_current
+ */
+static double updateStep(Matrix H_current, UpdateWorkspace *workspace, Solver solver, double beta, Matrix H_new) {
+    const SmallKernels *small = smallKernels(H_current.cols);
+    Matrix gram = workspace->gram;
+    Matrix nominator = workspace->nominator;
+    double *rowDiffs = workspace->rowDiffs;
+    double *rowTraces = workspace->rowTraces;
+    double change = 0.0, step = 0.0;
+    int gradient = (solver == SOLVER_PROJECTED_GRADIENT);
+    int i, j;
+
+    gramMatrixInto(H_current, gram);
+
+    if (gradient) {
+        step = beta / (3.0 * sqrt(squaredNormMatrix(gram)) + 1.0);
+    }
+
+#pragma omp parallel for num_threads(getNumThreads()) private(j)
+    for (i = 0; i < H_current.rows; i++) {
+        double *current = MATRIX_ROW(H_current, i);
+        double *updated = MATRIX_ROW(H_new, i);
+        double *nom = MATRIX_ROW(nominator, i);
+        double diff, sum = 0.0;
+
+        if (small != NULL) {
+            rowDiffs[i] = small->updateRow(current, nom, gram.data, gram.stride, gradient, step, beta,
+                                           updated, &rowTraces[i]);
+            continue;
+        }
+
+        for (j = 0; j < H_current.cols; j++) {
+            /* gram is symmetric, so its row j is also its column j. */
+            double denom = dotProduct(current, MATRIX_ROW(gram, j), H_current.cols);
+
+            if (gradient) {
+                updated[j] = current[j] - step * (denom - nom[j]);
+                updated[j] = (updated[j] > 0.0) ? updated[j] : 0.0;
+            }
+            else {
+                updated[j] = current[j] * (1 - beta + beta * (nom[j] / denom));
+            }
+
+            diff = updated[j] - current[j];
+            sum += diff * diff;
+        }
+        rowDiffs[i] = sum;
+        rowTraces[i] = dotProduct(current, nom, H_current.cols);
+    }
+
+    /* Rows are combined in order, so the result does not depend on the thread count. */
+    for (i = 0; i < H_current.rows; i++) {
+        change += rowDiffs[i];
+    }
+
+    return sqrt(change);
+}
+
+
+/* 
+ * Function to get the objective |W - H * transpose(H)|^2 of the H the last
+ * updateStep started from, less the constant |W|^2, as -2 trace(Ht W H) +
+ * |Ht H|^2 from the products that step already computed 
+ * Input: workspace - the workspace of that step
+ *        rows - number of rows of H
+ * Return: double - the objective minus |W|^2
+ */
+static double stepObjective(UpdateWorkspace *workspace, int rows) {
+    double trace = 0.0;
+    int i;
+
+    for (i = 0; i < rows; i++) {
+        trace += workspace->rowTraces[i];
+    }
+
+    return -2.0 * trace + squaredNormMatrix(workspace->gram);
+}
+
+
+/* 
+ * Function to get the objective of an H no updateStep started from, less
+ * |W|^2, as stepObjective does 
+ * Input: H - the H matrix (n x k)
+ *        workspace - its nominator must already hold W * H; its gram and
+ *                    rowTraces are overwritten
+ * Return: double - the objective minus |W|^2
+ */
+static double iterateObjective(Matrix H, UpdateWorkspace *workspace) {
+    int i;
+
+    gramMatrixInto(H, workspace->gram);
+
+#pragma omp parallel for num_threads(getNumThreads())
+    for (i = 0; i < H.rows; i++) {
+        workspace->rowTraces[i] = dotProduct(MATRIX_ROW(H, i), MATRIX_ROW(workspace->nominator, i), H.cols);
+    }
+
+    return stepObjective(workspace, H.rows);
+}
+
+
+/* 
+ * Function to tell whether a solve needs |W|^2 in options.weightNorm 
+ * Every step yields the objective less |W|^2, which is all the adaptive
+ * solvers compare; |W|^2, a full pass over W, is only added where an
+ * objective is reported or scaled by STOP_OBJECTIVE.
+ * Input: options - solver options
+ *        reported - nonzero if the caller reports an objective itself,
+ *                   through ConvergeControl or restart scores
+ * Return: int - 1 if weightNorm must be filled in, 0 otherwise
+ */
+int solverNeedsWeightNorm(const SolverOptions *options, int reported) {
+    return reported || options->stop == STOP_OBJECTIVE || options->objectives != NULL;
+}
+
+
+/* 
+ * Function to write the updated H into H_new, without allocating 
+ * W is only used through product(weights, H, result), which computes
+ * result = W * H for whichever representation weights points to.
+ * The denominator H * transpose(H) * H is evaluated as H * (transpose(H) * H),
+ * through the k x k Gram matrix, so no n x n matrix is ever formed. Each row
+ * of the denominator is computed right before it is used by the update, and
+ * the change of the row is measured in the same pass.
+ * Input: product, weights - the weight matrix W (n x n)
+ *        H_current - current H matrix (n x k)
+ *        workspace - buffers from createUpdateWorkspace(n, k)
+ *        H_new - output matrix (n x k); must not be H_current
+ * Return: double - Frobenius norm of H_new - H_current
+ */
+double updateHWith(WeightProduct product, const void *weights, Matrix H_current,
+                   UpdateWorkspace *workspace, Matrix H_new) {
+    product(weights, H_current, workspace->nominator);
+
+    return updateStep(H_current, workspace, SOLVER_MULTIPLICATIVE, SOLVER_DEFAULT_BETA, H_new);
+}
+
+
+/* Function to write the updated H into H_new for a dense W; see updateHWith. */
+double updateHInto(Matrix H_current, Matrix W, UpdateWorkspace *workspace, Matrix H_new) {
+    return updateHWith(denseWeightProduct, &W, H_current, workspace, H_new);
+}
+
+
+/* 
+ * Python wrapper helper function to update H matrix for convarge_H
+ * Input: H_current - current H matrix (n x k)
+ *        W - weight matrix (n x n)
+ * Return: Matrix - updated H matrix (n x k)
+ */
+Matrix update_H(Matrix H_current, Matrix W) {
+    UpdateWorkspace workspace = createUpdateWorkspace(H_current.rows, H_current.cols);
+    Matrix H_new = createZeroMatrix(H_current.rows, H_current.cols);
+
+    updateHInto(H_current, W, &workspace, H_new);
+
+    freeUpdateWorkspace(workspace);
+
+    return H_new;
+}
+
+
+/* Function to ask a running convergeHControlled to stop before its next iteration.
+ * Safe to call from any thread. */
+void cancelConvergence(ConvergeControl *control) {
+#pragma omp atomic write
+    control->cancelled = 1;
+}
+
+
+/* Function to read how far a running convergeHControlled has got.
+ * Safe to call from any thread.
+ * Return: int - iterations completed so far; *change is set to the
+ *         Frobenius norm of the last update of H when change is not NULL */
+int convergenceProgress(ConvergeControl *control, double *change) {
+    int iterations;
+
+#pragma omp atomic read
+    iterations = control->iterations;
+
+    if (change != NULL) {
+#pragma omp atomic read
+        *change = control->change;
+    }
+
+    return iterations;
+}
+
+
+/* Function to check whether cancelConvergence was called; NULL never is. */
+static int convergenceCancelled(ConvergeControl *control) {
+    int cancelled = 0;
+
+    if (control != NULL) {
+#pragma omp atomic read
+        cancelled = control->cancelled;
+    }
+
+    return cancelled;
+}
+
+
+/* Function to get the solver settings converge_H uses unless told otherwise. */
+SolverOptions defaultSolverOptions(void) {
+    SolverOptions options;
+
+    options.solver = SOLVER_MULTIPLICATIVE;
+    options.stop = STOP_CHANGE;
+    options.eps = SYMNMF_DEFAULT_EPS;
+    options.iter = SYMNMF_DEFAULT_ITER;
+    options.beta = SOLVER_DEFAULT_BETA;
+    options.patience = SOLVER_DEFAULT_PATIENCE;
+    options.weightNorm = 0.0;
+    options.objectives = NULL;
+
+    return options;
+}
+
+
+/* 
+ * Function to set the solver and stopping test of options by name 
+ * Input: solver - 'multiplicative', 'adaptive', 'nesterov' or 'gradient'
+ *        stop - 'change', 'objective' or 'labels'
+ *        options - output; other fields are left as they are
+ * Return: int - 0 on success, 1 if a name is unknown
+ */
+int parseSolverOptions(const char *solver, const char *stop, SolverOptions *options) {
+    static const char *solvers[] = {"multiplicative", "adaptive", "nesterov", "gradient"};
+    static const char *stops[] = {"change", "objective", "labels"};
+    int i, j;
+
+    for (i = 0; i < 4 && strcmp(solver, solvers[i]) != 0; i++) {
+    }
+    for (j = 0; j < 3 && strcmp(stop, stops[j]) != 0; j++) {
+    }
+    if (i == 4 || j == 3) {
+        return 1;
+    }
+
+    options->solver = (Solver)i;
+    options->stop = (StopCriterion)j;
+
+    return 0;
+}
+
+
+/* 
+ * Function to write the label of every row of H into labels 
+ * Return: int - number of labels that changed
+ */
+static int assignLabels(Matrix H, int *labels) {
+    const SmallKernels *small = smallKernels(H.cols);
+    int changed = 0;
+    int i, j, label;
+
+    for (i = 0; i < H.rows; i++) {
+        double *row = MATRIX_ROW(H, i);
+        label = 0;
+
+        if (small != NULL) {
+            label = small->argmaxRow(row);
+        }
+        else {
+            for (j = 1; j < H.cols; j++) {
+                if (row[j] > row[label]) {
+                    label = j;
+                }
+            }
+        }
+
+        changed += (label != labels[i]);
+        labels[i] = label;
+    }
+
+    return changed;
+}
+
+
+/* 
+ * Function to write the Nesterov point H + momentum * (H - H_previous) into 
+ * result; entries that would not stay positive, and so could never recover 
+ * under a multiplicative update, are kept at H 
+ */
+static void extrapolateH(Matrix H, Matrix H_previous, double momentum, Matrix result) {
+    int i, j;
+
+#pragma omp parallel for num_threads(getNumThreads()) private(j)
+    for (i = 0; i < H.rows; i++) {
+        double *current = MATRIX_ROW(H, i);
+        double *previous = MATRIX_ROW(H_previous, i);
+        double *out = MATRIX_ROW(result, i);
+
+        for (j = 0; j < H.cols; j++) {
+            out[j] = current[j] + momentum * (current[j] - previous[j]);
+            out[j] = (out[j] > 0.0) ? out[j] : current[j];
+        }
+    }
+}
+
+
+/* Function to compute the Frobenius norm of H_new - H, summing rows through rowDiffs (n). */
+static double distanceH(Matrix H_new, Matrix H, double *rowDiffs) {
+    double change = 0.0;
+    int i;
+
+#pragma omp parallel for num_threads(getNumThreads())
+    for (i = 0; i < H.rows; i++) {
+        rowDiffs[i] = squaredEuclideanDistance(MATRIX_ROW(H_new, i), MATRIX_ROW(H, i), H.cols);
+    }
+
+    for (i = 0; i < H.rows; i++) {
+        change += rowDiffs[i];
+    }
+
+    return sqrt(change);
+}
+
+
+/* Progress of one restart of solveRestarts. */
+typedef struct {
+    double beta;       /* Damping or step scale; changes for the adaptive solvers */
+    double objective;  /* Objective of the point its last update started from */
+    int restart;       /* SOLVER_NESTEROV: iteration its momentum restarted at */
+    int stable;        /* STOP_LABELS: iterations without a label change */
+    int stopped;       /* Its stopping test has passed */
+    int *labels;       /* STOP_LABELS: labels of its last iterate */
+} RestartState;
+
+
+/* Function to get the bytes of the arena solveRestarts carves its buffers out of. */
+static size_t solveRestartsBytes(int n, int k, int restarts, const SolverOptions *options) {
+    size_t bytes = updateWorkspaceBytes(n, restarts * k);
+
+    if (options->solver == SOLVER_NESTEROV) {
+        bytes += matrixBytes(n, restarts * k, sizeof(double));
+    }
+    if (options->solver == SOLVER_ADAPTIVE || options->solver == SOLVER_PROJECTED_GRADIENT) {
+        bytes += matrixBytes(n, restarts * k, sizeof(double));
+    }
+    if (options->stop == STOP_LABELS) {
+        bytes += (size_t)restarts * matrixBytes(1, n, sizeof(int));
+    }
+
+    return bytes;
+}
+
+
+/* Function to view the k columns of one restart slot of a wide matrix (n x R k) as an n x k matrix. */
+static Matrix slotView(Matrix wide, int slot, int k) {
+    return columnRange(wide, slot * k, k);
+}
+
+
+/* 
+ * Function to iteratively update several H matrices until convergence
+ * against one W, with any solver and stopping test, under the control of
+ * another thread 
+ * The restarts are the column slots of one n x (R k) matrix, so every
+ * iteration computes W * H for all of them in a single wide product; each
+ * slot is then updated and tested on its own. A restart that stops is
+ * copied out and the last active slot moves into its place, so the product
+ * narrows as restarts finish. With one restart this is convergeHSolve.
+ * Every update also yields the objective |W - H * transpose(H)|^2 of the
+ * point it started from, at the cost of O(nk): it steers the adaptive
+ * solvers, which grow beta up to 1 while the objective falls, and when it
+ * rises drop the step, return to the last accepted iterate and halve beta;
+ * SOLVER_NESTEROV restarts its momentum instead.
+ * Before every iteration the loop checks whether control was cancelled, and
+ * after every iteration it publishes its progress there, so another thread
+ * can watch or stop it without locks.
+ * Input: product, weights - the weight matrix W (n x n); see updateHWith
+ *        H - restarts initial H matrices (n x k each)
+ *        restarts - number of initial matrices
+ *        options - solver, stopping test and limits; objectives receives
+ *                  the smallest objective among the restarts
+ *        control - progress and cancellation, zero-initialized; may be NULL.
+ *                  change is the largest and objective the smallest among
+ *                  the active restarts
+ *        results - output: the converged H (n x k) of every restart; when
+ *                  cancelled, the last completed iterates
+ *        converged - output, restarts entries: the iterations after which
+ *                    every restart passed its stopping test; 0 if it did not
+ */
+static void solveRestarts(WeightProduct product, const void *weights, const Matrix *H, int restarts,
+                          const SolverOptions *options, ConvergeControl *control, Matrix *results,
+                          int *converged) {
+    int n = H[0].rows, k = H[0].cols;
+    Arena arena = createArena(solveRestartsBytes(n, k, restarts, options));
+    UpdateWorkspace workspace = carveUpdateWorkspace(&arena, n, restarts * k);
+    UpdateWorkspace slot = workspace;
+    RestartState *states = (RestartState *)malloc(((size_t)restarts + 1) * sizeof(RestartState));
+    int *order = (int *)malloc(((size_t)restarts + 1) * sizeof(int));
+    int adaptive = (options->solver == SOLVER_ADAPTIVE || options->solver == SOLVER_PROJECTED_GRADIENT);
+    Matrix current, next, start, nominator, extrapolated, accepted;
+    double change, objective, largest, smallest, recorded, momentum;
+    int active = restarts, buffer = 0;
+    int iteration, a, r, rejected;
+
+    if (states == NULL || order == NULL) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+    /* Each slot uses the top left k x k block of the wide Gram buffer. */
+    slot.gram.rows = slot.gram.cols = k;
+
+    /* Empty unless the solver uses them. */
+    extrapolated = accepted = arenaMatrix(&arena, 0, 0);
+    if (options->solver == SOLVER_NESTEROV) {
+        extrapolated = arenaMatrix(&arena, n, restarts * k);
+    }
+    if (adaptive) {
+        accepted = arenaMatrix(&arena, n, restarts * k);
+    }
+
+    /* Until an iteration completes, the results are copies of H. */
+    for (r = 0; r < restarts; r++) {
+        copyMatrixInto(H[r], slotView(workspace.buffers[0], r, k));
+        order[r] = r;
+        converged[r] = 0;
+        states[r].beta = options->beta;
+        states[r].objective = 0.0;
+        states[r].restart = 0;
+        states[r].stable = 0;
+        states[r].stopped = 0;
+        states[r].labels = NULL;
+        if (options->stop == STOP_LABELS) {
+            states[r].labels = (int *)arenaAlloc(&arena, matrixBytes(1, n, sizeof(int)));
+            assignLabels(H[r], states[r].labels);
+        }
+    }
+
+    /* Iterations alternate between the two workspace buffers; nothing is
+     * allocated inside the loop. */
+    for (iteration = 0; iteration < options->iter && active > 0 && !convergenceCancelled(control); iteration++) {
+        current = workspace.buffers[buffer];
+        next = workspace.buffers[1 - buffer];
+        nominator = workspace.nominator;
+        current.cols = next.cols = nominator.cols = active * k;
+        start = current;
+
+        /* next still holds the previous iterate, so it is read before it is overwritten. */
+        if (options->solver == SOLVER_NESTEROV) {
+            start = extrapolated;
+            start.cols = active * k;
+
+            for (a = 0; a < active; a++) {
+                r = order[a];
+                momentum = (iteration > states[r].restart) ?
+                           (double)(iteration - states[r].restart - 1) / (iteration - states[r].restart + 2) : 0.0;
+                extrapolateH(slotView(current, a, k), slotView(next, a, k), momentum, slotView(start, a, k));
+            }
+        }
+
+        /* Steps of SOLVER_NESTEROV start from the extrapolated point, so the
+         * objective of the iterate itself costs a product of its own, spent
+         * only when the objectives are recorded. */
+        recorded = HUGE_VAL;
+        if (start.data != current.data && options->objectives != NULL) {
+            product(weights, current, nominator);
+            for (a = 0; a < active; a++) {
+                slot.nominator = slotView(nominator, a, k);
+                objective = iterateObjective(slotView(current, a, k), &slot);
+                recorded = (objective < recorded) ? objective : recorded;
+            }
+        }
+
+        product(weights, start, nominator);
+
+        largest = 0.0;
+        smallest = HUGE_VAL;
+
+        for (a = 0; a < active; a++) {
+            r = order[a];
+            slot.nominator = slotView(nominator, a, k);
+
+            change = updateStep(slotView(start, a, k), &slot, options->solver, states[r].beta, slotView(next, a, k));
+            objective = stepObjective(&slot, n);
+
+            if (start.data != current.data) {
+                change = distanceH(slotView(next, a, k), slotView(current, a, k), slot.rowDiffs);
+            }
+
+            /* Written so that a NaN objective counts as a rise. */
+            rejected = 0;
+            if (iteration > 0 && !(objective <= states[r].objective)) {
+                states[r].restart = iteration + 1;
+                if (adaptive) {
+                    /* The step to start raised the objective: drop it and retry from the last accepted iterate. */
+                    states[r].beta = (states[r].beta / 2 > SOLVER_MIN_BETA) ? states[r].beta / 2 : SOLVER_MIN_BETA;
+                    copyMatrixInto(slotView(accepted, a, k), slotView(next, a, k));
+                    change = distanceH(slotView(next, a, k), slotView(current, a, k), slot.rowDiffs);
+                    rejected = 1;
+                }
+            }
+            else if (adaptive) {
+                if (iteration > 0) {
+                    states[r].beta = (states[r].beta * SOLVER_BETA_GROWTH < 1.0) ? states[r].beta * SOLVER_BETA_GROWTH : 1.0;
+                }
+                copyMatrixInto(slotView(start, a, k), slotView(accepted, a, k));
+            }
+
+            if (rejected) {
+                states[r].stable = 0;
+                states[r].stopped = 0;
+                if (states[r].labels != NULL) {
+                    assignLabels(slotView(next, a, k), states[r].labels);
+                }
+            }
+            else if (options->stop == STOP_OBJECTIVE) {
+                states[r].stopped = (iteration > 0 && fabs(states[r].objective - objective) <
+                                     options->eps * fabs(states[r].objective + options->weightNorm));
+            }
+            else if (options->stop == STOP_LABELS) {
+                states[r].stable = (assignLabels(slotView(next, a, k), states[r].labels) == 0) ? states[r].stable + 1 : 0;
+                states[r].stopped = (states[r].stable >= options->patience);
+            }
+            else {
+                states[r].stopped = (change < options->eps);
+            }
+
+            states[r].objective = rejected ? states[r].objective : objective;
+            largest = (change > largest) ? change : largest;
+            smallest = (objective < smallest) ? objective : smallest;
+        }
+
+        if (options->objectives != NULL) {
+            options->objectives[iteration] = ((start.data != current.data) ? recorded : smallest) + options->weightNorm;
+        }
+
+        if (control != NULL) {
+#pragma omp atomic write
+            control->change = largest;
+#pragma omp atomic write
+            control->objective = smallest + options->weightNorm;
+#pragma omp atomic write
+            control->iterations = iteration + 1;
+        }
+
+        buffer = 1 - buffer;
+
+        /* Stopped restarts leave; the last active slot takes their place in both buffers. */
+        for (a = 0; a < active; ) {
+            r = order[a];
+            if (!states[r].stopped) {
+                a++;
+                continue;
+            }
+
+            converged[r] = iteration + 1;
+            results[r] = createZeroMatrix(n, k);
+            copyMatrixInto(slotView(workspace.buffers[buffer], a, k), results[r]);
+
+            active--;
+            if (a != active) {
+                copyMatrixInto(slotView(workspace.buffers[buffer], active, k), slotView(workspace.buffers[buffer], a, k));
+                copyMatrixInto(slotView(workspace.buffers[1 - buffer], active, k), slotView(workspace.buffers[1 - buffer], a, k));
+                if (adaptive) {
+                    copyMatrixInto(slotView(accepted, active, k), slotView(accepted, a, k));
+                }
+                order[a] = order[active];
+            }
+        }
+    }
+
+    /* Only the cancellation test can end the loop with iterations and restarts left. */
+    if (control != NULL && iteration < options->iter && active > 0) {
+#pragma omp atomic write
+        control->stopped = 1;
+    }
+
+    for (a = 0; a < active; a++) {
+        results[order[a]] = createZeroMatrix(n, k);
+        copyMatrixInto(slotView(workspace.buffers[buffer], a, k), results[order[a]]);
+    }
+
+    free(states);
+    free(order);
+    freeArena(arena);
+}
+
+
+/* 
+ * Function to iteratively update H matrix until convergence, for any W,
+ * with any solver and stopping test, under the control of another thread;
+ * see solveRestarts 
+ * Input: product, weights - the weight matrix W (n x n); see updateHWith
+ *        H - initial H matrix (n x k)
+ *        options - solver, stopping test and limits; see SolverOptions
+ *        control - progress and cancellation, zero-initialized; may be NULL
+ * Return: Matrix - converged H matrix (n x k); when cancelled, the last
+ *         completed iterate. The iteration count is in control.
+ */
+Matrix convergeHSolve(WeightProduct product, const void *weights, Matrix H, const SolverOptions *options,
+                      ConvergeControl *control) {
+    Matrix result;
+    int converged;
+
+    solveRestarts(product, weights, &H, 1, options, control, &result, &converged);
+    if (converged > 0) {
+        printf("Converged after %d iterations.\n", converged);
+    }
+
+    return result;
+}
+
+
+/* 
+ * Function to converge several initial H matrices against one W and keep
+ * the best; see solveRestarts 
+ * After the restarts converge, one more wide product scores them all by
+ * their objective |W - H * transpose(H)|^2.
+ * Input: product, weights - the weight matrix W (n x n); see updateHWith
+ *        H - restarts initial H matrices (n x k each)
+ *        restarts - number of initial matrices, at least 1
+ *        options - solver, stopping test and limits; see SolverOptions
+ *        scores - output, restarts entries: the objective of every
+ *                 converged H; may be NULL
+ * Return: Matrix - the converged H with the smallest objective, the first
+ *         one on ties
+ */
+Matrix convergeHRestarts(WeightProduct product, const void *weights, const Matrix *H, int restarts,
+                         const SolverOptions *options, double *scores) {
+    int n = H[0].rows, k = H[0].cols;
+    Matrix *results = (Matrix *)malloc(((size_t)restarts + 1) * sizeof(Matrix));
+    int *converged = (int *)malloc(((size_t)restarts + 1) * sizeof(int));
+    Matrix bestH;
+    UpdateWorkspace workspace;
+    double objective, best = HUGE_VAL;
+    int r, i, chosen = 0;
+
+    if (results == NULL || converged == NULL) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+    solveRestarts(product, weights, H, restarts, options, NULL, results, converged);
+
+    /* A single restart needs no score unless one is asked for. */
+    if (restarts > 1 || scores != NULL) {
+        workspace = createUpdateWorkspace(n, restarts * k);
+        workspace.gram.rows = workspace.gram.cols = k;
+
+        for (r = 0; r < restarts; r++) {
+            copyMatrixInto(results[r], slotView(workspace.buffers[0], r, k));
+        }
+        product(weights, workspace.buffers[0], workspace.nominator);
+
+        for (r = 0; r < restarts; r++) {
+            Matrix slotH = slotView(workspace.buffers[0], r, k);
+            Matrix slotNominator = slotView(workspace.nominator, r, k);
+
+            gramMatrixInto(slotH, workspace.gram);
+            objective = squaredNormMatrix(workspace.gram);
+            for (i = 0; i < n; i++) {
+                objective -= 2.0 * dotProduct(MATRIX_ROW(slotH, i), MATRIX_ROW(slotNominator, i), k);
+            }
+
+            if (scores != NULL) {
+                scores[r] = objective + options->weightNorm;
+            }
+            if (objective < best) {
+                best = objective;
+                chosen = r;
+            }
+        }
+
+        freeUpdateWorkspace(workspace);
+    }
+
+    /* Only the run that is kept reports its convergence. */
+    if (converged[chosen] > 0) {
+        printf("Converged after %d iterations.\n", converged[chosen]);
+    }
+
+    for (r = 0; r < restarts; r++) {
+        if (r != chosen) {
+            freeMatrix(results[r]);
+        }
+    }
+    bestH = results[chosen];
+    free(results);
+    free(converged);
+
+    return bestH;
+}
+
+
+/* 
+ * Function to iteratively update H matrix until convergence, for any W,
+ * under the control of another thread; the default solver of convergeHSolve 
+ */
+Matrix convergeHControlled(WeightProduct product, const void *weights, Matrix H, double eps, int iter,
+                           ConvergeControl *control) {
+    SolverOptions options = defaultSolverOptions();
+
+    options.eps = eps;
+    options.iter = iter;
+
+    return convergeHSolve(product, weights, H, &options, control);
+}
+
+
+/* 
+ * Function to iteratively update H matrix until convergence, for any W 
+ * Input: product, weights - the weight matrix W (n x n); see updateHWith
+ *        H - initial H matrix (n x k)
+ *        eps - convergence threshold
+ *        iter - maximum number of iterations
+ * Return: Matrix - converged H matrix (n x k)
+ */
+Matrix convergeHWith(WeightProduct product, const void *weights, Matrix H, double eps, int iter) {
+    return convergeHControlled(product, weights, H, eps, iter, NULL);
+}
+
+
+/* 
+ * Python wrapper function to iteratively update H matrix until convergence 
+ * Input: H - initial H matrix (n x k)
+ *        W - weight matrix (n x n)
+ *        eps - convergence threshold. def = 0.0001
+ *        iter - maximum number of iterations. def = 300
+ * Return: Matrix - converged H matrix (n x k)
+ */
+Matrix converge_H(Matrix H, Matrix W, double eps, int iter) {
+    return convergeHWith(denseWeightProduct, &W, H, eps, iter);
+}
+
+
+/* 
+ * Python wrapper function to iteratively update H matrix until convergence,
+ * for a sparse W (see converge_H) 
+ */
+Matrix converge_H_sparse(Matrix H, SparseMatrix W, double eps, int iter) {
+    return convergeHWith(sparseWeightProduct, &W, H, eps, iter);
+}
+
+
+/* 
+ * Python wrapper function to iteratively update H matrix until convergence,
+ * for a single precision W (see converge_H) 
+ */
+Matrix converge_H_single(Matrix H, FloatMatrix W, double eps, int iter) {
+    return convergeHWith(singleWeightProduct, &W, H, eps, iter);
+}
+
+
+/* 
+ * Python wrapper function to iteratively update H matrix until convergence,
+ * for a W kept in a scratch file (see converge_H and symOutOfCore) 
+ */
+Matrix converge_H_streamed(Matrix H, MappedMatrix W, double eps, int iter) {
+    return convergeHWith(streamedWeightProduct, &W.matrix, H, eps, iter);
+}
+
 
-#define MAX_ROW_LEN 1024 /* Arbitrary max dim for data points. */
+/* 
+ * Python wrapper function to iteratively update H matrix until convergence,
+ * for an implicit W (see converge_H and implicitWeightProduct) 
+ */
+Matrix converge_H_implicit(Matrix H, ImplicitWeights W, double eps, int iter) {
+    return convergeHWith(implicitWeightProduct, &W, H, eps, iter);
+}
 
 
 /* 
- * Function to extract the dimensions (row x col) of the data file 
- * Input: fileName - path to the file containing the data
- * Output: n - pointer to number of rows; number of data points
- *         d - pointer to number of columns; dimention of each point
+ * Function to draw the initial H matrix 
+ * Entries are uniform on [0, 2 * sqrt(mean / k)], drawn row by row from an
+ * Rng, so a seed always gives the same H.
+ * Input: n - number of data points
+ *        k - number of clusters
+ *        mean - average of all entries of W
+ *        seed - seed of the random numbers
+ * Return: Matrix - initial H matrix (n x k)
  */
-void getDimension(const char *fileName, int* n, int* d) {
-    char line[MAX_ROW_LEN];
-    char *token;
-    FILE *file;
+Matrix initializeH(int n, int k, double mean, unsigned long seed) {
+    double upperBound = 2.0 * sqrt(mean / k);
+    Matrix H = createZeroMatrix(n, k);
+    Rng rng;
+    int i, j;
+
+    seedRng(&rng, seed);
+
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < k; j++) {
+            MATRIX_AT(H, i, j) = upperBound * uniformRng(&rng);
+        }
+    }
+
+    return H;
+}
 
-    *n = 0, *d = 0;
 
-    file = fopen(fileName, "r");
-    if (file == NULL) {
+/* 
+ * Function to assign every data point to a cluster 
+ * Input: H - association matrix (n x k)
+ * Return: int* - n labels; label i is the column of the largest entry in
+ *         row i of H, the first one on ties. Release with free.
+ */
+int *clusterLabels(Matrix H) {
+    int *labels = (int *)calloc((size_t)H.rows + 1, sizeof(int));
+
+    if (labels == NULL) {
         printf("An Error Has Occurred");
         exit(1);
     }
 
-    if (fgets(line, sizeof(line), file) != NULL) {
-        token = strtok(line, " \t\n");
-        
-        while (token != NULL) {
-            (*d)++;
-            token = strtok(NULL, " \t\n");
-        }
+    assignLabels(H, labels);
 
-        (*n)++;
+    return labels;
+}
+
+
+/* 
+ * Function to compute the distance of point i from every point 
+ * Input: pairs - see PairwiseDistances
+ *        norms - squared norms of the points of pairs.X, or NULL if pairs.X
+ *                is not used
+ *        i - the point
+ *        row - output; n distances, 0 for point i itself
+ * Return: double* - the distances; row, or row i of pairs.distances
+ */
+static double *distanceRow(PairwiseDistances pairs, const double *norms, int i, double *row) {
+    double *similarity, *point, squared;
+    int j;
+
+    if (pairs.distances.data != NULL) {
+        return MATRIX_ROW(pairs.distances, i);
     }
 
-    while (fgets(line, sizeof(line), file) != NULL) {
-        (*n)++;
+    similarity = (pairs.A.data != NULL) ? MATRIX_ROW(pairs.A, i) : NULL;
+    point = MATRIX_ROW(pairs.X, i);
+
+    for (j = 0; j < pairs.X.rows; j++) {
+        if (similarity != NULL && similarity[j] > 0.0) {
+            /* A_ij = exp(-||x_i - x_j||^2 / 2) */
+            squared = -2.0 * log(similarity[j]);
+        }
+        else {
+            squared = norms[i] + norms[j] - 2 * dotProduct(point, MATRIX_ROW(pairs.X, j), pairs.X.cols);
+        }
+        row[j] = (squared > 0.0) ? sqrt(squared) : 0.0;
     }
+    row[i] = 0.0;
 
-    fclose(file);
+    return row;
 }
 
 
 /* 
- * Function to read data from a file and return it as a matrix 
- * Input: filename - path to the file containing the data
- *        n - pointer to number of rows; number of data points
- *        d - pointer to number of columns; dimention of each point
- * Return: Matrix - the data points from the file as a matrix
+ * Function to compute the silhouette coefficient of several labelings 
+ * The silhouette of point i is (b - a) / max(a, b), where a is its mean
+ * distance to the other points of its cluster and b its smallest mean
+ * distance to the points of another cluster; it is 0 for a point alone in
+ * its cluster. Each row of distances is computed once and read for every
+ * labeling; rows run in parallel blocks, and the score of a labeling is
+ * the mean over the points, summed in row order.
+ * Input: pairs - the distances; see PairwiseDistances
+ *        labels - count labelings of the n points, one after the other;
+ *                 every label at least 0
+ *        count - number of labelings
+ *        scores - output; the score of each labeling, in [-1, 1]
  */
-Matrix readData(const char* filename, int n, int d) {
-    char line[MAX_ROW_LEN];
-    int row, col;
-    char *token;
-    FILE *file;
-    Matrix X;
+void silhouetteScores(PairwiseDistances pairs, const int *labels, int count, double *scores) {
+    int n = (pairs.distances.data != NULL) ? pairs.distances.rows : pairs.X.rows;
+    double *norms = NULL, *silhouettes;
+    int *offsets, *counts;
+    int l, i, clusters, rowStart;
+
+    offsets = (int *)calloc((size_t)count + 1, sizeof(int));
+    silhouettes = (double *)calloc((size_t)count * n + 1, sizeof(double));
+
+    if (offsets == NULL || silhouettes == NULL) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
 
-    X = createZeroMatrix(n, d);
+    /* Clusters of labeling l are offsets[l] to offsets[l + 1] - 1 in counts. */
+    for (l = 0; l < count; l++) {
+        clusters = 0;
+        for (i = 0; i < n; i++) {
+            clusters = (labels[(size_t)l * n + i] >= clusters) ? labels[(size_t)l * n + i] + 1 : clusters;
+        }
+        offsets[l + 1] = offsets[l] + clusters;
+    }
 
-    file = fopen(filename, "r");
+    counts = (int *)calloc((size_t)offsets[count] + 1, sizeof(int));
 
-    if (file == NULL) {
+    if (counts == NULL) {
         printf("An Error Has Occurred");
         exit(1);
     }
 
-    row = 0;
+    for (l = 0; l < count; l++) {
+        for (i = 0; i < n; i++) {
+            counts[offsets[l] + labels[(size_t)l * n + i]]++;
+        }
+    }
+
+    if (pairs.distances.data == NULL) {
+        pairs.X = centerData(pairs.X);
+        norms = squaredNorms(pairs.X);
+    }
+
+#pragma omp parallel num_threads(getNumThreads())
+    {
+        double *row = (double *)malloc(((size_t)n + 1) * sizeof(double));
+        double *sums = (double *)malloc(((size_t)offsets[count] + 1) * sizeof(double));
+        double *distances, *clusterSums, own, other, nearest;
+        const int *labeling;
+        int *clusterCounts;
+        int current, c, j, k;
+
+        if (row == NULL || sums == NULL) {
+            printf("An Error Has Occurred");
+            exit(1);
+        }
+
+#pragma omp for schedule(dynamic)
+        for (rowStart = 0; rowStart < n; rowStart += SYM_BLOCK_SIZE) {
+            for (current = rowStart; current < n && current < rowStart + SYM_BLOCK_SIZE; current++) {
+                distances = distanceRow(pairs, norms, current, row);
+                memset(sums, 0, (size_t)offsets[count] * sizeof(double));
+
+                for (k = 0; k < count; k++) {
+                    labeling = labels + (size_t)k * n;
+                    clusterSums = sums + offsets[k];
+                    clusterCounts = counts + offsets[k];
+
+                    for (j = 0; j < n; j++) {
+                        clusterSums[labeling[j]] += distances[j];
+                    }
+
+                    c = labeling[current];
+                    if (clusterCounts[c] < 2) {
+                        continue;
+                    }
+                    own = clusterSums[c] / (clusterCounts[c] - 1);
+
+                    nearest = -1.0;
+                    for (j = 0; j < offsets[k + 1] - offsets[k]; j++) {
+                        if (j != c && clusterCounts[j] > 0) {
+                            other = clusterSums[j] / clusterCounts[j];
+                            nearest = (nearest < 0.0 || other < nearest) ? other : nearest;
+                        }
+                    }
+
+                    if (nearest >= 0.0 && (own > 0.0 || nearest > 0.0)) {
+                        silhouettes[(size_t)k * n + current] = (nearest - own) / ((own > nearest) ? own : nearest);
+                    }
+                }
+            }
+        }
 
-    /* Reading file line by line by tokenizing. */
-    while (fgets(line, sizeof(line), file)) {
-        token = strtok(line, " ");
-        col = 0;
+        free(row);
+        free(sums);
+    }
 
-        while (token != NULL) {
-            char *endptr;
-            X.data[row][col] = strtod(token, &endptr);
-            token = strtok(NULL, " ");
-            col++;
+    for (l = 0; l < count; l++) {
+        scores[l] = 0.0;
+        for (i = 0; i < n; i++) {
+            scores[l] += silhouettes[(size_t)l * n + i];
         }
-        row++;
+        scores[l] /= n;
     }
 
-    fclose(file);
+    free(norms);
+    if (pairs.distances.data == NULL) {
+        freeMatrix(pairs.X);
+    }
+    free(offsets);
+    free(counts);
+    free(silhouettes);
+}
 
-    return X;
+
+/* Function to get the settings the symnmf goal uses unless told otherwise. */
+SymnmfOptions defaultSymnmfOptions(void) {
+    SymnmfOptions options;
+
+    options.solver = defaultSolverOptions();
+    options.seed = 0;
+    options.neighbours = 0;
+    options.radius = 0.0;
+    options.precision = PRECISION_DOUBLE;
+    options.scratchFile = NULL;
+    options.implicit = 0;
+    options.restarts = 1;
+    options.scores = NULL;
+
+    return options;
 }
 
 
 /* 
- * Function to compute the similarity matrix 
+ * Function to converge H for a W built by symnmfFactor 
+ * Restart r starts from initializeH with seed options->seed + r; with more
+ * than one restart they run together against W, see convergeHRestarts.
+ * Input: product, weights - the weight matrix W (n x n)
+ *        n, k - size of H
+ *        mean - average of all entries of W
+ *        options - see SymnmfOptions
+ * Return: Matrix - the converged H (n x k), the best one over the restarts
+ */
+static Matrix factorWeights(WeightProduct product, const void *weights, int n, int k, double mean,
+                            const SymnmfOptions *options) {
+    int restarts = (options->restarts > 1) ? options->restarts : 1;
+    Matrix *H_init = (Matrix *)malloc(((size_t)restarts + 1) * sizeof(Matrix));
+    Matrix H;
+    int r;
+
+    if (H_init == NULL) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+
+    for (r = 0; r < restarts; r++) {
+        H_init[r] = initializeH(n, k, mean, options->seed + (unsigned long)r);
+    }
+
+    H = convergeHRestarts(product, weights, H_init, restarts, &options->solver, options->scores);
+
+    for (r = 0; r < restarts; r++) {
+        freeMatrix(H_init[r]);
+    }
+    free(H_init);
+
+    return H;
+}
+
+
+/* 
+ * Function to estimate the peak memory of symnmfFactor, before running it 
+ * The estimate is the largest total of the allocations alive together, X
+ * included; a scratch file is not counted, as it is memory mapped. The
+ * sparse graphs are counted with every candidate edge kept (2 n knn edges,
+ * or all pairs for a radius), so for them it is an upper bound.
+ * Input: n, d - size of the data matrix
+ *        k - number of clusters
+ *        options - as for symnmfFactor; the thread count also matters for
+ *                  an implicit W
+ * Return: size_t - peak bytes
+ */
+size_t symnmfFootprint(int n, int d, int k, SymnmfOptions options) {
+    int restarts = (options.restarts > 1) ? options.restarts : 1;
+    size_t data = matrixBytes(n, d, sizeof(double));
+    size_t vector = matrixBytes(1, n, sizeof(double)); /* Norms, degrees and D^-1/2 */
+    size_t dense = matrixBytes(n, n, sizeof(double));
+    size_t factor, solve, weights, build, edges, nnz;
+
+    /* factorWeights keeps the initial H matrices and the results through the
+     * solve and through the scoring workspace after it. */
+    solve = solveRestartsBytes(n, k, restarts, &options.solver);
+    solve = (solve > updateWorkspaceBytes(n, restarts * k)) ? solve : updateWorkspaceBytes(n, restarts * k);
+    factor = 2 * (size_t)restarts * matrixBytes(n, k, sizeof(double)) + solve;
+
+    if (options.neighbours > 0 || options.radius > 0.0) {
+        edges = (options.radius > 0.0) ? (size_t)n * (n - 1) : 2 * (size_t)n * options.neighbours;
+        nnz = (edges < (size_t)n * (n - 1)) ? edges : (size_t)n * (n - 1);
+        weights = ((size_t)n + 1) * sizeof(int) + (nnz + 1) * (sizeof(int) + sizeof(double));
+        /* symNeighbours sorts its candidate edges, symRadius keeps a tile of
+         * distances and the upper triangle, which may grow to the size of A;
+         * normSparse holds A, D, D^-1/2 and W. */
+        edges = (options.radius > 0.0) ? matrixBytes(outOfCoreTileRows(n, n), n, sizeof(double)) + weights + vector
+                                       : edges * sizeof(GraphEdge);
+        build = (weights + edges > 2 * weights + 2 * vector) ? weights + edges : 2 * weights + 2 * vector;
+    }
+    else if (options.implicit) {
+        /* createImplicitWeights keeps centered data and takes its degrees from
+         * ddgTiled, which keeps one tile of A; every thread of
+         * implicitWeightProduct has a block of W. */
+        weights = data + 2 * vector;
+        build = data + matrixBytes(outOfCoreTileRows(n, n), n, sizeof(double)) + 3 * vector;
+        factor += (size_t)getNumThreads() * matrixBytes(SYM_BLOCK_SIZE, IMPLICIT_BLOCK_COLS, sizeof(double));
+    }
+    else if (options.scratchFile != NULL) {
+        /* symOutOfCore writes A into the file and keeps centered data, the
+         * norms, D and D^-1/2. */
+        weights = 0;
+        build = data + 3 * vector;
+    }
+    else if (options.precision == PRECISION_SINGLE) {
+        weights = matrixBytes(n, n, sizeof(float));
+        build = weights + data + 2 * vector;
+    }
+    else {
+        /* sym keeps centered data beside A; normInto holds A, D and D^-1/2,
+         * and turns A into W. */
+        weights = dense;
+        build = dense + data + 2 * vector;
+    }
+
+    return data + ((build > weights + factor) ? build : weights + factor);
+}
+
+
+/* 
+ * Function to run the full SymNMF on a data matrix 
+ * W is built, averaged, and used by every iteration without leaving C;
+ * the degree matrix is freed as soon as W exists, and a dense W is the
+ * similarity matrix normalized in place.
  * Input: X - data matrix (n x d)
- * Return: Matrix - similarity matrix (n x n)
+ *        k - number of clusters
+ *        options - how W is built and H converged; see SymnmfOptions
+ *         The objectives of options.solver are exact except for an implicit
+ *         W, whose squared norm is never computed.
+ * Return: Matrix - converged H matrix (n x k), see clusterLabels; empty
+ *         (data == NULL) if the scratch file cannot be created, or if a
+ *         sparse graph has no edges, which leaves H nothing to factor
  */
-Matrix sym(Matrix X){
-    double *currentVector, *otherVector;
-    int current, other;
-    double distance;
-    Matrix A;
+Matrix symnmfFactor(Matrix X, int k, SymnmfOptions options) {
+    SparseMatrix A_sparse, W_sparse;
+    FloatMatrix W_single;
+    MappedMatrix W_mapped;
+    ImplicitWeights W_implicit;
+    Matrix W, H;
+    DiagMatrix D;
 
-    A = createZeroMatrix(X.rows, X.rows);
+    if (options.neighbours > 0 || options.radius > 0.0) {
+        A_sparse = symKnn(X, options.neighbours, options.radius);
+        D = ddgSparse(A_sparse);
+        W_sparse = normSparse(D, A_sparse);
+        freeSparseMatrix(A_sparse);
+        freeDiagMatrix(D);
 
-    for (current = 0; current < X.rows; current++){
+        /* W = 0 would start H at 0, and the updates would divide 0 by 0. */
+        if (W_sparse.nnz == 0) {
+            freeSparseMatrix(W_sparse);
+            H.data = NULL;
+            H.block = NULL;
+            return H;
+        }
 
-        for (other = 0; other < X.rows; other++){
+        if (solverNeedsWeightNorm(&options.solver, options.scores != NULL)) {
+            options.solver.weightNorm = squaredNormSparseMatrix(W_sparse);
+        }
+        H = factorWeights(sparseWeightProduct, &W_sparse, X.rows, k, meanSparseMatrix(W_sparse), &options);
+        freeSparseMatrix(W_sparse);
+    }
+    else if (options.implicit) {
+        W_implicit = createImplicitWeights(X);
 
-            if (current != other){
-                currentVector = X.data[current];
-                otherVector = X.data[other];
+        H = factorWeights(implicitWeightProduct, &W_implicit, X.rows, k, meanImplicitWeights(W_implicit), &options);
+        freeImplicitWeights(W_implicit);
+    }
+    else if (options.scratchFile != NULL) {
+        if (symOutOfCore(X, 1, options.scratchFile, &W_mapped) != 0) {
+            H.data = NULL;
+            H.block = NULL;
+            return H;
+        }
 
-                distance = squaredEuclideanDistance(currentVector, otherVector, X.cols);
-                A.data[current][other] =  exp((distance / -2));
-            }
-            else{
-                A.data[current][other] = 0.0;
-            }
+        if (solverNeedsWeightNorm(&options.solver, options.scores != NULL)) {
+            options.solver.weightNorm = squaredNormMatrix(W_mapped.matrix);
         }
+        H = factorWeights(streamedWeightProduct, &W_mapped.matrix, X.rows, k, meanMatrix(W_mapped.matrix), &options);
+        unmapMatrixFile(W_mapped);
     }
+    else if (options.precision == PRECISION_SINGLE) {
+        W_single = symSingle(X);
+        D = ddgSingle(W_single);
+        W_single = normSingle(D, W_single);
+        freeDiagMatrix(D);
 
-    return A;
+        if (solverNeedsWeightNorm(&options.solver, options.scores != NULL)) {
+            options.solver.weightNorm = squaredNormFloatMatrix(W_single);
+        }
+        H = factorWeights(singleWeightProduct, &W_single, X.rows, k, meanFloatMatrix(W_single), &options);
+        freeFloatMatrix(W_single);
+    }
+    else {
+        /* A is normalized in place, so W takes no second n x n matrix. */
+        W = sym(X);
+        D = ddg(W);
+        normInto(D, W, W);
+        freeDiagMatrix(D);
+
+        if (solverNeedsWeightNorm(&options.solver, options.scores != NULL)) {
+            options.solver.weightNorm = squaredNormMatrix(W);
+        }
+        H = factorWeights(denseWeightProduct, &W, X.rows, k, meanMatrix(W), &options);
+        freeMatrix(W);
+    }
+
+    return H;
 }
 
 
 /* 
- * Function to compute the diagonal degree matrix 
- * Input: A - similarity matrix (n x n)
- * Return: Matrix - diagonal degree matrix (n x n)
+ * Function to run the full SymNMF on a data matrix and keep what a later
+ * extendSymnmf needs 
+ * Input: X - data matrix (n x d); copied
+ *        k - number of clusters
+ *        options - seed and solver; W is always dense and in double
+ *                  precision, so the storage options are ignored
+ * Return: SymnmfModel - release with freeSymnmfModel
  */
-Matrix ddg(Matrix A){
-    int diag;
-    Matrix D;
+SymnmfModel createSymnmfModel(Matrix X, int k, SymnmfOptions options) {
+    SymnmfModel model;
+    Matrix W;
 
-    D = createZeroMatrix(A.rows, A.cols);
+    model.X = createZeroMatrix(X.rows, X.cols);
+    copyMatrixInto(X, model.X);
+    model.A = sym(model.X);
+    model.D = ddg(model.A);
+    model.capacity = X.rows;
 
-    for (diag = 0; diag < A.rows; diag++){
-        D.data[diag][diag] = sumRow(A, diag);
+    W = norm(model.D, model.A);
+    if (solverNeedsWeightNorm(&options.solver, options.scores != NULL)) {
+        options.solver.weightNorm = squaredNormMatrix(W);
     }
+    model.H = factorWeights(denseWeightProduct, &W, X.rows, k, meanMatrix(W), &options);
+    freeMatrix(W);
 
-    return D;
+    return model;
 }
 
+
 /* 
- * Function to compute the normalized Laplacian matrix 
- * Input: D - diagonal degree matrix (n x n)
- *        A - similarity matrix (n x n)
- * Return: Matrix - normalized Laplacian matrix (n x n)
+ * Function to add data points to a factorization and converge it again 
+ * Only the similarities of the new points are computed: A keeps its old
+ * block, gets the new rows from symBlock and mirrors them into the new
+ * columns, and every old degree grows by its similarities to the new
+ * points. When the storage of previous has room for the new points, X and
+ * A grow in place: the new rows and columns lie outside the old n x n
+ * views, so those stay unchanged, and the old block is never copied.
+ * Otherwise both move to new storage with room for capacity points, so
+ * later calls can grow in place. W is rebuilt from A by scaling alone,
+ * since every degree may have changed. The new rows of H start as the
+ * W-weighted average of the old rows of H, and converge_H is warm-started
+ * from there instead of from a random H.
+ * Input: previous - the factorization so far (n points); its views are left
+ *                   unchanged, and its matrices may be views
+ *        X_new - the new data points (m x d)
+ *        solver - how H is converged again; weightNorm is filled in when
+ *                 needed
+ *        capacity - points new storage has room for; at least n + m is used
+ * Return: SymnmfModel - the factorization of all n + m points; release with
+ *         freeSymnmfModel. Grown in place, its X and A are views
+ *         (block == NULL) of the storage of previous, which must outlive
+ *         them, and only the latest model may be grown again.
  */
-Matrix norm(Matrix D, Matrix A){
-    Matrix W, T;
+SymnmfModel extendSymnmf(const SymnmfModel *previous, Matrix X_new, SolverOptions solver, int capacity) {
+    int n = previous->X.rows, m = X_new.rows, total = n + m, k = previous->H.cols;
+    SymnmfModel model;
+    Matrix rows, newH, W, W_new;
+    double *norms, weight;
+    Matrix centered;
+    int i, j;
 
-    T = powerDiagMatrix(D, (-0.5));
-    W = multiplyMatrix(T, A);
-    W = multiplyMatrix(W, T);
+    if (X_new.cols != previous->X.cols || previous->A.rows != n || previous->A.cols != n ||
+        previous->D.size != n || previous->H.rows != n || k < 1 || m < 1) {
+        printf("An Error Has Occurred");
+        exit(1);
+    }
 
-    freeMatrix(T);
+    if (previous->capacity >= total) {
+        model.X = previous->X;
+        model.A = previous->A;
+        model.X.block = model.A.block = NULL;
+        model.capacity = previous->capacity;
+    }
+    else {
+        model.capacity = (capacity > total) ? capacity : total;
+        model.X = createZeroMatrix(model.capacity, X_new.cols);
+        model.A = createZeroMatrix(model.capacity, model.capacity);
+        copyMatrixInto(previous->X, rowRange(model.X, 0, n));
+        copyMatrixInto(previous->A, columnRange(rowRange(model.A, 0, n), 0, n));
+    }
+    model.X.rows = total;
+    model.A.rows = model.A.cols = total;
+    copyMatrixInto(X_new, rowRange(model.X, n, m));
 
-    return W;
+    /* The new rows are computed and mirrored into the new columns. */
+
+    centered = centerData(model.X);
+    norms = squaredNorms(centered);
+    symBlock(centered, norms, n, 0, rowRange(model.A, n, m));
+    free(norms);
+    freeMatrix(centered);
+
+    model.D = createDiagMatrix(total);
+
+#pragma omp parallel for num_threads(getNumThreads()) private(j)
+    for (i = 0; i < n; i++) {
+        double *out = MATRIX_ROW(model.A, i);
+        double sum = 0.0;
+
+        for (j = n; j < total; j++) {
+            out[j] = MATRIX_AT(model.A, j, i);
+            sum += out[j];
+        }
+        model.D.values[i] = previous->D.values[i] + sum;
+    }
+    for (i = n; i < total; i++) {
+        model.D.values[i] = sumRow(model.A, i);
+    }
+
+    W = norm(model.D, model.A);
+
+    /* New rows of H: their rows of W (old columns only) times the old H, normalized. */
+    newH = createZeroMatrix(total, k);
+    copyMatrixInto(previous->H, rowRange(newH, 0, n));
+
+    W_new = columnRange(rowRange(W, n, m), 0, n);
+    rows = rowRange(newH, n, m);
+    multiplyMatrixInto(W_new, previous->H, rows);
+
+    for (i = 0; i < m; i++) {
+        weight = sumRow(W_new, i);
+
+        for (j = 0; j < k; j++) {
+            MATRIX_AT(rows, i, j) = (weight > 0.0) ? MATRIX_AT(rows, i, j) / weight : 0.0;
+        }
+    }
+
+    if (solverNeedsWeightNorm(&solver, 0)) {
+        solver.weightNorm = squaredNormMatrix(W);
+    }
+    model.H = convergeHSolve(denseWeightProduct, &W, newH, &solver, NULL);
+
+    freeMatrix(newH);
+    freeMatrix(W);
+
+    return model;
+}
+
+
+/* Function to free the memory allocated for a SymnmfModel. */
+void freeSymnmfModel(SymnmfModel model) {
+    freeMatrix(model.X);
+    freeMatrix(model.A);
+    freeDiagMatrix(model.D);
+    freeMatrix(model.H);
 }
 
+
 /* 
- * Python wrapper function for different goals:
- * Input: goal - goal type:
-            i. sym: Calculate and output the Similarity Matrix
-            ii. ddg: Calculate and output the Diagonal Degree Matrix
-            iii. norm: Calculate and output the Normalized Similarity Matrix
- *        fileName - name of the file containing the data
- * Return: Matrix - the result based on the specified goal
+ * Function to print the result of a goal on the sparse similarity graph 
+ * Input: goal - symknn or sym (the graph), ddg or norm
+ *        X - data matrix (n x d)
+ *        neighbours, radius - graph parameters; see symKnn
+ * Return: int - 0 on success, 1 for an unknown goal
  */
-Matrix symnmf(char *goal, char *fileName){
-    int n, d;
-    Matrix X;
-    Matrix A;
-    Matrix D;
-    Matrix W;
+static int printSparseGoal(const char *goal, Matrix X, int neighbours, double radius){
+    SparseMatrix A, W;
+    DiagMatrix D;
 
-    getDimension(fileName, &n, &d);
+    if (strcmp(goal, "symknn") != 0 && strcmp(goal, "sym") != 0 &&
+        strcmp(goal, "ddg") != 0 && strcmp(goal, "norm") != 0){
+        return 1;
+    }
 
-    X = readData(fileName, n, d);
+    A = symKnn(X, neighbours, radius);
 
-    if (strcmp(goal,"sym") == 0){
-        A = sym(X);
-        freeMatrix(X);  
-        return A;
+    if (strcmp(goal, "ddg") == 0){
+        D = ddgSparse(A);
+        printDiagMatrix(D);
+        freeDiagMatrix(D);
     }
-    if (strcmp(goal,"ddg") == 0){
-        A = sym(X);
-        D = ddg(A);
-        freeMatrix(X);  
-        freeMatrix(A);  
-        return D;
+    else if (strcmp(goal, "norm") == 0){
+        D = ddgSparse(A);
+        W = normSparse(D, A);
+        printSparseMatrix(W);
+        freeSparseMatrix(W);
+        freeDiagMatrix(D);
     }
-    if (strcmp(goal,"norm") == 0){
-        A = sym(X);
-        D = ddg(A);
-        W = norm(D, A);
-        freeMatrix(X);  
-        freeMatrix(A);  
-        freeMatrix(D);  
-        return W;
+    else{
+        printSparseMatrix(A);
     }
 
-    freeMatrix(X);
-    return X;
+    freeSparseMatrix(A);
+
+    return 0;
 }
 
 
 /* 
- * Python wrapper helper function to update H matrix for convarge_H
- * Input: H_current - current H matrix (n x k)
- *        W - weight matrix (n x n)
- * Return: Matrix - updated H matrix (n x k)
+ * Function to print the result of a dense goal with single precision storage 
+ * Input: goal - sym, ddg or norm
+ *        X - data matrix (n x d)
+ * Return: int - 0 on success, 1 for an unknown goal
  */
-Matrix update_H(Matrix H_current, Matrix W) {
-    Matrix denominator = multiplyMatrix(multiplyMatrix(H_current, transposeMatrix(H_current)), H_current);
-    Matrix H_new = createZeroMatrix(H_current.rows, H_current.cols);
-    Matrix nominator = multiplyMatrix(W, H_current);
-    double beta = 0.5;
-    int i, j;
+static int printSingleGoal(const char *goal, Matrix X){
+    FloatMatrix A;
+    DiagMatrix D;
 
-    for (i = 0; i < H_current.rows; i++) {
-        for (j = 0; j < H_current.cols; j++) {
-            H_new.data[i][j] = H_current.data[i][j] * (1 - beta + beta * (nominator.data[i][j] / denominator.data[i][j]));
-        }
+    if (strcmp(goal, "sym") != 0 && strcmp(goal, "ddg") != 0 && strcmp(goal, "norm") != 0){
+        return 1;
     }
 
-    freeMatrix(nominator);
-    freeMatrix(denominator);
+    A = symSingle(X);
 
-    return H_new;
+    if (strcmp(goal, "ddg") == 0){
+        D = ddgSingle(A);
+        printDiagMatrix(D);
+        freeDiagMatrix(D);
+    }
+    else if (strcmp(goal, "norm") == 0){
+        D = ddgSingle(A);
+        A = normSingle(D, A);
+        printFloatMatrix(A);
+        freeDiagMatrix(D);
+    }
+    else{
+        printFloatMatrix(A);
+    }
+
+    freeFloatMatrix(A);
+
+    return 0;
 }
 
 
 /* 
- * Python wrapper function to iteratively update H matrix until convergence 
- * Input: H - initial H matrix (n x k)
- *        W - weight matrix (n x n)
- *        eps - convergence threshold. def = 0.0001
- *        iter - maximum number of iterations. def = 300
- * Return: Matrix - converged H matrix (n x k)
+ * Function to output the result of a goal 
+ * Input: matrix - the result
+ *        outputFile - binary matrix file to write, or NULL to print the matrix
  */
-Matrix converge_H(Matrix H, Matrix W, double eps, int iter) {
-    Matrix H_new = createZeroMatrix(H.rows, H.cols);
-    int k;
+static void outputMatrix(Matrix matrix, const char *outputFile){
+
+    if (outputFile == NULL){
+        printMatrix(matrix);
+    }
+    else if (saveMatrixFile(outputFile, matrix) != 0){
+        printf("An Error Has Occurred");
+        exit(1);
+    }
+}
+
 
-    for (k = 0; k < iter; k++) {
-        H_new = update_H(H, W);
+/* 
+ * Function to output the result of a dense goal computed out of core 
+ * Input: goal - sym, ddg or norm
+ *        X - data matrix (n x d)
+ *        scratchFile - path of the scratch file for A or W; see symOutOfCore
+ *        outputFile - binary matrix file to write, or NULL to print the result
+ * Return: int - 0 on success, 1 for an unknown goal or scratch file failure
+ */
+static int outputOutOfCoreGoal(const char *goal, Matrix X, const char *scratchFile, const char *outputFile){
+    MappedMatrix result;
+    DiagMatrix D;
+    Matrix view;
+    int failed;
+
+    if (strcmp(goal, "sym") == 0){
+        failed = symOutOfCore(X, 0, scratchFile, &result);
+    }
+    else if (strcmp(goal, "norm") == 0){
+        failed = symOutOfCore(X, 1, scratchFile, &result);
+    }
+    else if (strcmp(goal, "ddg") == 0){
+        D = ddgTiled(X);
 
-        if (frobeniusNorm(H_new, H) < eps) {
-            printf("Converged after %d iterations.\n", k + 1);
-            break;
+        /* View the degree vector as an n x 1 matrix. */
+        view.rows = D.size;
+        view.cols = 1;
+        view.stride = 1;
+        view.data = D.values;
+        view.block = NULL;
+        if (outputFile == NULL){
+            printDiagMatrix(D);
+        }
+        else{
+            outputMatrix(view, outputFile);
         }
-        
-        H = H_new;
+        freeDiagMatrix(D);
+        return 0;
+    }
+    else{
+        return 1;
     }
 
-    return H_new;
+    if (failed){
+        return 1;
+    }
+
+    outputMatrix(result.matrix, outputFile);
+    unmapMatrixFile(result);
+
+    return 0;
 }
 
 
 /* 
  * Main function to run different goals based on input arguments 
+ * Usage: symnmf [--threads N] [--knn K | --radius R] [--output FILE]
+ *               [--k K] [--seed S] [--precision double|single]
+ *               [--scratch FILE] [--weights dense|implicit]
+ *               [--solver NAME] [--stop NAME] [--eps E] [--iter N]
+ *               [--restarts R] goal file
+ * With --knn or --radius, or for the symknn goal, the sym, ddg and norm
+ * goals work on the sparse similarity graph instead of the dense one.
+ * The symnmf goal runs the full factorization into --k clusters (required)
+ * from an initial H drawn with --seed (default 0), and prints H; with --knn
+ * or --radius it factorizes the sparse graph.
+ * With --output, the dense goals and symnmf write a binary matrix file
+ * instead of printing; ddg writes its degree vector as an n x 1 matrix.
+ * --precision single stores the dense n x n matrices in single precision
+ * (all arithmetic stays in double); it cannot be combined with --output
+ * for the sym, ddg and norm goals.
+ * --scratch computes the dense goals out of core: A or W is written to
+ * FILE (deleted again on exit) one row tile at a time, and symnmf streams
+ * W from it in every iteration. It takes precedence over --precision.
+ * --weights implicit makes symnmf recompute W from the data in every
+ * iteration instead of storing it (see implicitWeightProduct); it takes
+ * precedence over --scratch and --precision.
+ * --solver, --stop, --eps and --iter choose how symnmf converges H; see
+ * parseSolverOptions for the names. --restarts R runs R initial H matrices
+ * (seeds S to S + R - 1) together against one W and prints the best.
+ * file may be a text file or a binary matrix file.
  * Input: argc - number of command-line arguments
  *        argv - array of command-line arguments
  * Return: int - exit status
  */
 int main(int argc, char *argv[]) {
     const char *fileName;
+    const char *outputFile = NULL;
+    const char *solverName = "multiplicative";
+    const char *stopName = "change";
     char *goal;
-    int n, d;
+    int arg;
+    int clusters = 0;
+    SymnmfOptions options = defaultSymnmfOptions();
     Matrix X;
     Matrix A;
-    Matrix D;
+    DiagMatrix D;
     Matrix W;
 
-    if (argc > 0){
-        goal = argv[1];
-        fileName = argv[2];
+    /* Options come before the goal, each followed by its value. */
+    for (arg = 1; arg + 1 < argc && strncmp(argv[arg], "--", 2) == 0; arg += 2){
+
+        if (strcmp(argv[arg], "--threads") == 0){
+            setNumThreads(atoi(argv[arg + 1]));
+        }
+        else if (strcmp(argv[arg], "--knn") == 0){
+            options.neighbours = atoi(argv[arg + 1]);
+        }
+        else if (strcmp(argv[arg], "--radius") == 0){
+            options.radius = atof(argv[arg + 1]);
+        }
+        else if (strcmp(argv[arg], "--output") == 0){
+            outputFile = argv[arg + 1];
+        }
+        else if (strcmp(argv[arg], "--k") == 0){
+            clusters = atoi(argv[arg + 1]);
+        }
+        else if (strcmp(argv[arg], "--seed") == 0){
+            options.seed = strtoul(argv[arg + 1], NULL, 10);
+        }
+        else if (strcmp(argv[arg], "--precision") == 0 && strcmp(argv[arg + 1], "single") == 0){
+            options.precision = PRECISION_SINGLE;
+        }
+        else if (strcmp(argv[arg], "--precision") == 0 && strcmp(argv[arg + 1], "double") == 0){
+            options.precision = PRECISION_DOUBLE;
+        }
+        else if (strcmp(argv[arg], "--scratch") == 0){
+            options.scratchFile = argv[arg + 1];
+        }
+        else if (strcmp(argv[arg], "--weights") == 0 && strcmp(argv[arg + 1], "implicit") == 0){
+            options.implicit = 1;
+        }
+        else if (strcmp(argv[arg], "--weights") == 0 && strcmp(argv[arg + 1], "dense") == 0){
+            options.implicit = 0;
+        }
+        else if (strcmp(argv[arg], "--solver") == 0){
+            solverName = argv[arg + 1];
+        }
+        else if (strcmp(argv[arg], "--stop") == 0){
+            stopName = argv[arg + 1];
+        }
+        else if (strcmp(argv[arg], "--eps") == 0){
+            options.solver.eps = atof(argv[arg + 1]);
+        }
+        else if (strcmp(argv[arg], "--iter") == 0){
+            options.solver.iter = atoi(argv[arg + 1]);
+        }
+        else if (strcmp(argv[arg], "--restarts") == 0){
+            options.restarts = atoi(argv[arg + 1]);
+        }
+        else{
+            printf("An Error Has Occurred\n");
+            exit(1);
+        }
+    }
+
+    if (argc - arg == 2 && parseSolverOptions(solverName, stopName, &options.solver) == 0){
+        goal = argv[arg];
+        fileName = argv[arg + 1];
     }
     else{
          printf("An Error Has Occurred\n");
          exit(1);
     }
 
-    getDimension(fileName, &n, &d);
+    X = loadData(fileName);
+
+    if (strcmp(goal,"footprint") == 0) {
+        /* The peak memory the symnmf goal would take with these options. */
+        if (clusters < 1 || clusters >= X.rows){
+            printf("An Error Has Occurred");
+            exit(1);
+        }
+        printf("%lu\n", (unsigned long)symnmfFootprint(X.rows, X.cols, clusters, options));
+    }
+    else if (strcmp(goal,"symnmf") == 0) {
+        if (clusters < 1 || clusters >= X.rows){
+            printf("An Error Has Occurred");
+            exit(1);
+        }
 
-    X = readData(fileName, n, d);
+        A = symnmfFactor(X, clusters, options);
+        if (A.data == NULL){
+            printf("An Error Has Occurred");
+            exit(1);
+        }
+        outputMatrix(A, outputFile);
+        freeMatrix(A);
+    }
+    else if ((strcmp(goal,"symknn") == 0) || options.neighbours > 0 || options.radius > 0.0) {
+        options.neighbours = (options.neighbours > 0) ? options.neighbours : SYMKNN_DEFAULT_NEIGHBOURS;
 
-    if ((strcmp(goal,"sym") == 0) || (strcmp(goal,"ddg") == 0) || (strcmp(goal,"norm") == 0)) {
+        if (outputFile != NULL || printSparseGoal(goal, X, options.neighbours, options.radius) != 0){
+            printf("An Error Has Occurred");
+            exit(1);
+        }
+    }
+    else if (options.scratchFile != NULL) {
+        if (outputOutOfCoreGoal(goal, X, options.scratchFile, outputFile) != 0){
+            printf("An Error Has Occurred");
+            exit(1);
+        }
+    }
+    else if (options.precision == PRECISION_SINGLE) {
+        /* Binary matrix files hold doubles only. */
+        if (outputFile != NULL || printSingleGoal(goal, X) != 0){
+            printf("An Error Has Occurred");
+            exit(1);
+        }
+    }
+    else if ((strcmp(goal,"sym") == 0) || (strcmp(goal,"ddg") == 0) || (strcmp(goal,"norm") == 0)) {
         A = sym(X);
 
         if ((strcmp(goal,"ddg") == 0) || (strcmp(goal,"norm") == 0)){
             D = ddg(A);
 
             if (strcmp(goal,"norm") == 0){
-                W = norm(D, A);
+                /* A becomes W in place. */
+                normInto(D, A, A);
+                W = A;
             }
         }
             if (strcmp(goal, "sym") == 0){
-                    printMatrix(A);
+                    outputMatrix(A, outputFile);
                     freeMatrix(A);
             }
             else if (strcmp(goal, "ddg") == 0){
-                    printMatrix(D);
-                    freeMatrix(D);
+                    if (outputFile == NULL){
+                        printDiagMatrix(D);
+                    }
+                    else{
+                        /* View the degree vector as an n x 1 matrix. */
+                        W.rows = D.size;
+                        W.cols = 1;
+                        W.stride = 1;
+                        W.data = D.values;
+                        W.block = NULL;
+                        outputMatrix(W, outputFile);
+                    }
+                    freeDiagMatrix(D);
                     freeMatrix(A); 
             } 
             else if (strcmp(goal, "norm") == 0){
-                    printMatrix(W);
+                    outputMatrix(W, outputFile);
                     freeMatrix(W);
-                    freeMatrix(D); 
-                    freeMatrix(A); 
+                    freeDiagMatrix(D); 
         }
     } 
     else{
@@ -321,5 +2671,7 @@ int main(int argc, char *argv[]) {
         exit(1);
     }
 
+    freeMatrix(X);
+
     return 0;
 }
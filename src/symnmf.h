@@ -2,14 +2,152 @@
 #define SYMNMF_H
 
 #include "matrix.h"
+#include "sparse.h"
+#include "dataio.h"
 
-void getDimension(const char *fileName, int* n, int* d);
-Matrix readData(const char* filename, int n, int d);
+/* Preallocated buffers for the iterations of converge_H, carved out of one arena. */
+typedef struct {
+    Matrix gram;       /* k x k: transpose(H) * H */
+    Matrix nominator;  /* n x k: W * H */
+    Matrix buffers[2]; /* n x k: the two H matrices converge_H alternates between */
+    double *rowDiffs;  /* n: squared change of each row of H, for the convergence test */
+    double *rowTraces; /* n: row i of H times row i of W * H, for the objective */
+    Arena arena;       /* Owns the buffers; empty if they belong to a larger arena */
+} UpdateWorkspace;
+
+/* Function type computing result = W * H for one representation of W (n x n). */
+typedef void (*WeightProduct)(const void *weights, Matrix H, Matrix result);
+
+/* State of a convergeHControlled call shared with other threads. */
+typedef struct {
+    int cancelled;   /* Nonzero stops the loop before its next iteration */
+    int iterations;  /* Iterations completed so far */
+    double change;   /* Frobenius norm of the last update of H */
+    double objective; /* Objective of the point the last update started from */
+    int stopped;     /* Set once the loop has ended because it was cancelled */
+} ConvergeControl;
+
+/* Rule convergeHSolve updates H with. */
+typedef enum {
+    SOLVER_MULTIPLICATIVE,    /* Damped multiplicative update with a fixed beta */
+    SOLVER_ADAPTIVE,          /* Multiplicative; beta grows while the objective falls */
+    SOLVER_NESTEROV,          /* Multiplicative from an extrapolated point, restarted when the objective rises */
+    SOLVER_PROJECTED_GRADIENT /* Gradient step of length beta / L, projected onto H >= 0 */
+} Solver;
+
+/* Test convergeHSolve stops on. */
+typedef enum {
+    STOP_CHANGE,    /* Frobenius norm of the update of H below eps */
+    STOP_OBJECTIVE, /* Relative decrease of the objective below eps */
+    STOP_LABELS     /* clusterLabels unchanged for patience iterations */
+} StopCriterion;
+
+/* How convergeHSolve updates H and when it stops. */
+typedef struct {
+    Solver solver;
+    StopCriterion stop;
+    double eps;         /* Threshold of the stopping test */
+    int iter;           /* Maximum number of iterations */
+    double beta;        /* Damping of the multiplicative rules, or step scale; at most 1 */
+    int patience;       /* Iterations the labels must stay unchanged for STOP_LABELS */
+    double weightNorm;  /* Squared Frobenius norm of W, added to every objective; see solverNeedsWeightNorm */
+    double *objectives; /* If not NULL, receives the objective of every iteration (iter entries) */
+} SolverOptions;
+
+/* Settings of symnmfFactor besides the data and the number of clusters. */
+typedef struct {
+    SolverOptions solver;    /* Update rule, stopping test and threshold */
+    unsigned long seed;      /* Seed of the initial H; see initializeH */
+    int neighbours;          /* With neighbours or radius above zero, W is the */
+    double radius;           /* normalized sparse similarity graph; see symKnn */
+    Precision precision;     /* Storage of a dense W in memory */
+    const char *scratchFile; /* If not NULL, a dense W is kept in this file instead */
+    int implicit;            /* Nonzero: W is never stored; see ImplicitWeights */
+    int restarts;            /* Initial H matrices run together; the best is kept */
+    double *scores;          /* If not NULL, receives the objective of every restart */
+} SymnmfOptions;
+
+/* The normalized similarity matrix W = D^-1/2 A D^-1/2, given implicitly by
+ * the data it is computed from; see implicitWeightProduct. */
+typedef struct {
+    Matrix X;          /* Data matrix (n x d) with its mean subtracted */
+    double *norms;     /* Squared norms of the data points */
+    DiagMatrix scale;  /* D^-1/2 */
+} ImplicitWeights;
+
+/* A factorization that new data points can be added to; see extendSymnmf. */
+typedef struct {
+    Matrix X;      /* Data points (n x d) */
+    Matrix A;      /* Similarity matrix (n x n) */
+    DiagMatrix D;  /* Degrees: the row sums of A */
+    Matrix H;      /* Converged H (n x k) */
+    int capacity;  /* Points the storage of X and A has room for: rows of X, rows and columns of A */
+} SymnmfModel;
+
+/* The pairwise distances silhouetteScores reads; the first one given is used. */
+typedef struct {
+    Matrix distances;  /* Euclidean distances (n x n), used as they are; unused if data is NULL */
+    Matrix A;          /* Similarity matrix from sym (n x n); distances are recovered as
+                        * sqrt(-2 ln A), and from X where A underflowed to 0. Unused if data is NULL */
+    Matrix X;          /* Data points (n x d) */
+} PairwiseDistances;
+
+double *squaredNorms(Matrix X);
+Matrix centerData(Matrix X);
+void symBlock(Matrix X, const double *norms, int rowStart, int colStart, Matrix block);
 Matrix sym(Matrix X);
-Matrix ddg(Matrix A);
-Matrix norm(Matrix D, Matrix A);
+DiagMatrix ddg(Matrix A);
+Matrix norm(DiagMatrix D, Matrix A);
+void normInto(DiagMatrix D, Matrix A, Matrix W);
+FloatMatrix symSingle(Matrix X);
+DiagMatrix ddgSingle(FloatMatrix A);
+FloatMatrix normSingle(DiagMatrix D, FloatMatrix A);
+DiagMatrix ddgTiled(Matrix X);
+int symOutOfCore(Matrix X, int normalize, const char *scratchFile, MappedMatrix *result);
+SparseMatrix symKnn(Matrix X, int neighbours, double radius);
+DiagMatrix ddgSparse(SparseMatrix A);
+SparseMatrix normSparse(DiagMatrix D, SparseMatrix A);
+size_t updateWorkspaceBytes(int n, int k);
+UpdateWorkspace createUpdateWorkspace(int n, int k);
+void freeUpdateWorkspace(UpdateWorkspace workspace);
+void denseWeightProduct(const void *weights, Matrix H, Matrix result);
+void sparseWeightProduct(const void *weights, Matrix H, Matrix result);
+void singleWeightProduct(const void *weights, Matrix H, Matrix result);
+void streamedWeightProduct(const void *weights, Matrix H, Matrix result);
+ImplicitWeights createImplicitWeights(Matrix X);
+void freeImplicitWeights(ImplicitWeights weights);
+void implicitWeightProduct(const void *weights, Matrix H, Matrix result);
+double meanImplicitWeights(ImplicitWeights weights);
+double updateHWith(WeightProduct product, const void *weights, Matrix H_current,
+                   UpdateWorkspace *workspace, Matrix H_new);
+double updateHInto(Matrix H_current, Matrix W, UpdateWorkspace *workspace, Matrix H_new);
 Matrix update_H(Matrix H_current, Matrix W);
+void cancelConvergence(ConvergeControl *control);
+int convergenceProgress(ConvergeControl *control, double *change);
+Matrix convergeHControlled(WeightProduct product, const void *weights, Matrix H, double eps, int iter,
+                           ConvergeControl *control);
+SolverOptions defaultSolverOptions(void);
+int parseSolverOptions(const char *solver, const char *stop, SolverOptions *options);
+Matrix convergeHSolve(WeightProduct product, const void *weights, Matrix H, const SolverOptions *options,
+                      ConvergeControl *control);
+int solverNeedsWeightNorm(const SolverOptions *options, int reported);
+Matrix convergeHRestarts(WeightProduct product, const void *weights, const Matrix *H, int restarts,
+                         const SolverOptions *options, double *scores);
+Matrix convergeHWith(WeightProduct product, const void *weights, Matrix H, double eps, int iter);
 Matrix converge_H(Matrix H, Matrix W, double eps, int iter);
+Matrix converge_H_sparse(Matrix H, SparseMatrix W, double eps, int iter);
+Matrix converge_H_single(Matrix H, FloatMatrix W, double eps, int iter);
+Matrix converge_H_streamed(Matrix H, MappedMatrix W, double eps, int iter);
+Matrix converge_H_implicit(Matrix H, ImplicitWeights W, double eps, int iter);
+Matrix initializeH(int n, int k, double mean, unsigned long seed);
+int *clusterLabels(Matrix H);
+void silhouetteScores(PairwiseDistances pairs, const int *labels, int count, double *scores);
+SymnmfOptions defaultSymnmfOptions(void);
+size_t symnmfFootprint(int n, int d, int k, SymnmfOptions options);
+Matrix symnmfFactor(Matrix X, int k, SymnmfOptions options);
+SymnmfModel createSymnmfModel(Matrix X, int k, SymnmfOptions options);
+SymnmfModel extendSymnmf(const SymnmfModel *previous, Matrix X_new, SolverOptions solver, int capacity);
+void freeSymnmfModel(SymnmfModel model);
 Matrix symnmf(char *goal, char *fileName);
 
 #endif /* SYMNMF_H */
\ No newline at end of file
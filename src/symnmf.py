@@ -14,6 +14,7 @@ def sys_arguments():
         ii. sym: Calculate and output the similarity matrix.
         iii. ddg: Calculate and output the Diagonal Degree Matrix.
         iv. norm: Calculate and output the normalized similarity matrix.
+        v. symknn: Calculate and output the sparse k-nearest-neighbour similarity matrix.
     3. file_name (str): The path to the Input file, it will contain N data points for all above
         goals, the file extension is .txt
 
@@ -29,7 +30,7 @@ def sys_arguments():
         goal = sys.argv[2]
         file_name = sys.argv[3]
 
-        if goal not in ["symnmf", "sym", "ddg", "norm"]:
+        if goal not in ["symnmf", "sym", "ddg", "norm", "symknn"]:
             raise ValueError("An Error Has Occrred")
 
     except ValueError:
@@ -39,18 +40,36 @@ def sys_arguments():
     return k, goal, file_name
 
 
+MATRIX_FILE_MAGIC = b"SYMNMF01"
+
+
 def read_data(file_name: str) -> np.ndarray:
     """
     Reads the data from the input file.
-    :param file_name: The name of the text file containing the data.
+    :param file_name: The name of the text file containing the data, or of a binary matrix file
+        written by save_matrix / symnmf --output.
     :return: The data stored in the file as a NumPy array.
     """
+    with open(file_name, 'rb') as f:
+        is_binary = f.read(len(MATRIX_FILE_MAGIC)) == MATRIX_FILE_MAGIC
+    if is_binary:
+        return symnmf.load_matrix_c(file_name)
+
     with open(file_name, 'r') as f:
         lines = f.readlines()
         data = [[float(x) for x in line.strip().split(',')] for line in lines]
     return np.array(data)
 
 
+def save_matrix(file_name: str, matrix) -> None:
+    """
+    Writes a matrix to a binary matrix file, which read_data and the symnmf binary load without parsing.
+    :param file_name: The name of the file to write.
+    :param matrix: 2-D array-like (a 1-D one is written as a column).
+    """
+    symnmf.save_matrix_c(file_name, matrix)
+
+
 def h_initialization(k: int, n: int, m: float) -> np.ndarray:
     """
     Randomly initialize H with values from the interval [0, 2 ∗ sqrt(m/k)].
@@ -119,15 +138,58 @@ def print_np_list(np_list):
     """
     for row in np_list:
         print(",".join(f"{value:.4f}" for value in row))
-        
 
-def symNMF(x, k, n, epsilon=0.0001, max_iter=300):
-    W = symnmf.symnmf_c('norm', x)
-    H_init = h_initialization(k=k, n=n, m=np.mean(W))
-    H_final = symnmf.converge_h_c(H_init, W, epsilon, max_iter)
 
-    labels = np.argmax(H_final, axis=1)
-    
+def print_diag_list(diag):
+    """
+    Print a diagonal matrix given by its diagonal entries, in the same format as print_np_list,
+    without building the full n×n matrix.
+    Args:
+        diag: 1-D array of the diagonal entries
+    """
+    n = len(diag)
+    for i, value in enumerate(diag):
+        row = ["0.0000"] * n
+        row[i] = f"{value:.4f}"
+        print(",".join(row))
+
+
+def print_csr_list(csr):
+    """
+    Print a sparse matrix given as an (indptr, indices, data) triple, in the same format as
+    print_np_list, without building the full n×n matrix.
+    Args:
+        csr: (indptr, indices, data) as returned by the C extension
+    """
+    indptr, indices, data = csr
+    n = len(indptr) - 1
+    for i in range(n):
+        row = ["0.0000"] * n
+        for k in range(indptr[i], indptr[i + 1]):
+            row[indices[k]] = f"{data[k]:.4f}"
+        print(",".join(row))
+
+
+def symNMF(x, k, n, epsilon=0.0001, max_iter=300, threads=0, knn=0, seed=0, scratch=None,
+           weights='dense', solver='multiplicative', stop='change', restarts=1):
+    """
+    Run the full SymNMF and return the cluster label of each data point.
+    Everything from W to the labels is computed in one C call, so W never crosses into Python.
+    threads sets the number of C worker threads; 0 uses SYMNMF_NUM_THREADS or all cores.
+    knn > 0 runs on the sparse graph of the knn nearest neighbours of each point.
+    seed seeds the C random generator drawing the initial H (not np.random), so equal seeds give
+    equal labels.
+    scratch names a scratch file that holds W instead of memory, for data too large for a dense W.
+    weights='implicit' never stores W at all and recomputes it from x in every iteration instead.
+    solver ('multiplicative', 'adaptive', 'nesterov' or 'gradient') and stop ('change', 'objective'
+    or 'labels') choose how H is converged; see converge_h_c.
+    restarts > 1 runs that many initial H (seeds seed, seed + 1, ...) together against one W and keeps
+    the one with the smallest objective.
+    """
+    result = symnmf.symnmf_c('symnmf', x, threads=threads, knn=knn, k=k, eps=epsilon, iter=max_iter, seed=seed,
+                             scratch=scratch, weights=weights, solver=solver, stop=stop, restarts=restarts)
+    labels = result[0]
+
     return labels
     
     
@@ -156,7 +218,12 @@ def main():
     elif(goal == "ddg"):
         D = symnmf.symnmf_c('ddg', x)
         
-        print_np_list(D)
+        print_diag_list(D)
+
+    elif(goal == "symknn"):
+        A = symnmf.symnmf_c('symknn', x)
+
+        print_csr_list(A)
 
     elif(goal == "norm"):   
         W = symnmf.symnmf_c('norm', x)
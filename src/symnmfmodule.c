@@ -2,244 +2,1776 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 #include <numpy/arrayobject.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
 #include "matrix.h"
 #include "symnmf.c"
 
 
+#define BLOCK_CAPSULE_NAME "mysymnmf.block"     /* Capsule over a malloc'd buffer */
+#define MAPPING_CAPSULE_NAME "mysymnmf.mapping" /* Capsule over a malloc'd MappedMatrix */
+#define GROWABLE_CAPSULE_NAME "mysymnmf.growable" /* Capsule over a malloc'd GrowableMatrix */
+
+
+/* Storage of an X or A from extend_symnmf_c with room for more points, so
+ * the next call can grow it in place; see extendSymnmf. */
+typedef struct {
+    void *block;   /* Allocation holding the matrix */
+    double *data;  /* Its first element */
+    int capacity;  /* Points it has room for */
+    int used;      /* Points of the latest model stored in it; only that one may grow it */
+} GrowableMatrix;
+
+
+/* 
+ * Release the C allocation behind a NumPy array 
+ * Input: owner - malloc'd buffer, or malloc'd MappedMatrix for
+ *                MAPPING_CAPSULE_NAME or GrowableMatrix for GROWABLE_CAPSULE_NAME
+ *        name - capsule name telling them apart
+ */
+static void release_owner(void *owner, const char *name) {
+    if (strcmp(name, MAPPING_CAPSULE_NAME) == 0) {
+        unmapMatrixFile(*(MappedMatrix *)owner);
+    }
+    if (strcmp(name, GROWABLE_CAPSULE_NAME) == 0) {
+        free(((GrowableMatrix *)owner)->block);
+    }
+    free(owner);
+}
+
+
+/* Capsule destructor: runs when the last NumPy array using the allocation dies. */
+static void release_capsule(PyObject *capsule) {
+    const char *name = PyCapsule_GetName(capsule);
+    release_owner(PyCapsule_GetPointer(capsule, name), name);
+}
+
+
+/* 
+ * Wrap a C buffer as a NumPy array without copying it 
+ * Input: nd, dims, strides - shape and byte strides of the array
+ *        type - NumPy type number of the elements
+ *        data - first element
+ *        owner, name - allocation holding data, see release_owner
+ * Return: PyObject* - array that frees owner when it is collected, or NULL
+ *         with a Python error set. Ownership of owner passes to this function
+ *         in either case; on failure it is released at once.
+ */
+static PyObject* adopt_buffer(int nd, npy_intp *dims, npy_intp *strides, int type, void *data,
+                              void *owner, const char *name) {
+    PyObject *array, *capsule;
+
+    capsule = PyCapsule_New(owner, name, release_capsule);
+    if (capsule == NULL) {
+        release_owner(owner, name);
+        return NULL;
+    }
+
+    array = PyArray_New(&PyArray_Type, nd, dims, type, strides, data, 0, NPY_ARRAY_WRITEABLE, NULL);
+    if (array == NULL) {
+        Py_DECREF(capsule);
+        return NULL;
+    }
+
+    /* Steals the capsule reference, also when it fails. */
+    if (PyArray_SetBaseObject((PyArrayObject *)array, capsule) != 0) {
+        Py_DECREF(array);
+        return NULL;
+    }
+
+    return array;
+}
+
+
+/* 
+ * Wrap a 2-D NumPy array as a row-major view, without copying 
+ * Arrays whose rows are contiguous and evenly spaced, C-contiguous ones and
+ * the padded arrays this module returns alike, are used in place; anything
+ * else is first converted to a C-contiguous array.
+ * Input: obj - array-like to convert
+ *        type, elementSize - NumPy type number and size of the elements
+ *        rows, cols, stride, data - output; the layout of the view
+ * Return: PyArrayObject* - the array backing the view, which the caller must
+ *         hold while it uses the view and release afterwards, or NULL with a
+ *         Python error set
+ */
+static PyArrayObject* convert_numpy_to_rows(PyObject *obj, int type, npy_intp elementSize,
+                                            int *rows, int *cols, int *stride, void **data) {
+    PyArrayObject *array, *contiguous;
+    npy_intp rowCount, colCount, rowStride;
+
+    array = (PyArrayObject *)PyArray_FROM_OTF(obj, type, NPY_ARRAY_ALIGNED);
+    if (array == NULL || PyArray_NDIM(array) != 2 ||
+        PyArray_DIM(array, 0) > INT_MAX || PyArray_DIM(array, 1) > INT_MAX) {
+        Py_XDECREF(array);
+        PyErr_SetString(PyExc_TypeError, "An Error Has Occurred");
+        return NULL;
+    }
+
+    rowCount = PyArray_DIM(array, 0);
+    colCount = PyArray_DIM(array, 1);
+    rowStride = (rowCount > 1) ? PyArray_STRIDE(array, 0) / elementSize : colCount;
+
+    if ((colCount > 1 && PyArray_STRIDE(array, 1) != elementSize) ||
+        (rowCount > 1 && (PyArray_STRIDE(array, 0) % elementSize != 0 || rowStride < colCount || rowStride > INT_MAX))) {
+        contiguous = (PyArrayObject *)PyArray_FROM_OTF((PyObject *)array, type, NPY_ARRAY_IN_ARRAY);
+        Py_DECREF(array);
+        if (contiguous == NULL) {
+            return NULL;
+        }
+        array = contiguous;
+        rowStride = colCount;
+    }
+
+    *rows = (int)rowCount;
+    *cols = (int)colCount;
+    *stride = (int)rowStride;
+    *data = PyArray_DATA(array);
+
+    return array;
+}
+
+
+/* 
+ * Wrap a 2-D NumPy array as a Matrix view, without copying 
+ * Input: obj - array-like to convert; see convert_numpy_to_rows
+ *        matrix - output; a view (block == NULL) of the array's buffer
+ * Return: PyArrayObject* - the array backing the view, or NULL with a
+ *         Python error set; see convert_numpy_to_rows
+ */
+static PyArrayObject* convert_numpy_to_matrix(PyObject *obj, Matrix *matrix) {
+    void *data = NULL;
+    PyArrayObject *array = convert_numpy_to_rows(obj, NPY_DOUBLE, sizeof(double),
+                                                 &matrix->rows, &matrix->cols, &matrix->stride, &data);
+
+    matrix->data = (double *)data;
+    matrix->block = NULL;
+
+    return array;
+}
+
+
+/* 
+ * Wrap a 2-D NumPy array of data points as a Matrix view, without copying 
+ * The distances of a point with an infinite or NaN coordinate are not
+ * defined, so such data is rejected.
+ * Input: obj - array-like to convert; see convert_numpy_to_matrix
+ *        matrix - output; a view (block == NULL) of the array's buffer
+ * Return: PyArrayObject* - the array backing the view, or NULL with a
+ *         Python error set
+ */
+static PyArrayObject* convert_numpy_to_data(PyObject *obj, Matrix *matrix) {
+    PyArrayObject *array = convert_numpy_to_matrix(obj, matrix);
+
+    if (array != NULL && !isFiniteMatrix(*matrix)) {
+        Py_DECREF(array);
+        PyErr_SetString(PyExc_ValueError, "An Error Has Occurred");
+        return NULL;
+    }
+
+    return array;
+}
+
+
+/* 
+ * Wrap a 2-D float32 NumPy array as a FloatMatrix view, without copying 
+ * Input: obj - array-like to convert; see convert_numpy_to_rows
+ *        matrix - output; a view (block == NULL) of the array's buffer
+ * Return: PyArrayObject* - the array backing the view, or NULL with a
+ *         Python error set; see convert_numpy_to_rows
+ */
+static PyArrayObject* convert_numpy_to_float_matrix(PyObject *obj, FloatMatrix *matrix) {
+    void *data = NULL;
+    PyArrayObject *array = convert_numpy_to_rows(obj, NPY_FLOAT32, sizeof(float),
+                                                 &matrix->rows, &matrix->cols, &matrix->stride, &data);
+
+    matrix->data = (float *)data;
+    matrix->block = NULL;
+
+    return array;
+}
+
+
+/* 
+ * Convert a Matrix struct to a 2-D NumPy array, without copying 
+ * Input: matrix - Matrix struct owning its storage; the array takes it over
+ *        (the matrix must not be freed afterwards, even on failure)
+ * Return: PyObject* - float64 array sharing the matrix's padded row layout,
+ *         or NULL with a Python error set
+ */
+static PyObject* convert_matrix_to_numpy(Matrix matrix) {
+    npy_intp dims[2], strides[2];
+
+    dims[0] = matrix.rows;
+    dims[1] = matrix.cols;
+    strides[0] = (npy_intp)matrix.stride * sizeof(double);
+    strides[1] = sizeof(double);
+
+    return adopt_buffer(2, dims, strides, NPY_DOUBLE, matrix.data, matrix.block, BLOCK_CAPSULE_NAME);
+}
+
+
+/* 
+ * Convert the X or A of a SymnmfModel to a 2-D NumPy array, without copying,
+ * that a later extend_symnmf_c can grow in place 
+ * Input: matrix - X or A; owning its storage (block != NULL), which the
+ *                 array takes over as convert_matrix_to_numpy does, or a view
+ *                 grown in the storage of growable
+ *        capacity - points the storage has room for
+ *        growable - capsule of the storage matrix was grown in, or NULL
+ * Return: PyObject* - float64 array, or NULL with a Python error set
+ */
+static PyObject* convert_growable_to_numpy(Matrix matrix, int capacity, PyObject *growable) {
+    npy_intp dims[2], strides[2];
+    GrowableMatrix *owner;
+    PyObject *array;
+
+    dims[0] = matrix.rows;
+    dims[1] = matrix.cols;
+    strides[0] = (npy_intp)matrix.stride * sizeof(double);
+    strides[1] = sizeof(double);
+
+    if (growable == NULL) {
+        owner = (GrowableMatrix *)malloc(sizeof(GrowableMatrix));
+        if (owner == NULL) {
+            freeMatrix(matrix);
+            return PyErr_NoMemory();
+        }
+        owner->block = matrix.block;
+        owner->data = matrix.data;
+        owner->capacity = capacity;
+        owner->used = matrix.rows;
+
+        return adopt_buffer(2, dims, strides, NPY_DOUBLE, matrix.data, owner, GROWABLE_CAPSULE_NAME);
+    }
+
+    array = PyArray_New(&PyArray_Type, 2, dims, NPY_DOUBLE, strides, matrix.data, 0, NPY_ARRAY_WRITEABLE, NULL);
+    if (array == NULL) {
+        return NULL;
+    }
+
+    Py_INCREF(growable);
+    if (PyArray_SetBaseObject((PyArrayObject *)array, growable) != 0) {
+        Py_DECREF(array);
+        return NULL;
+    }
+
+    return array;
+}
+
+
+/* 
+ * Find the storage an X or A from extend_symnmf_c was grown in, if it is
+ * that of the latest model stored there 
+ * Input: obj - the array passed in
+ *        rows - its number of points
+ * Return: PyObject* - the capsule of the storage (borrowed), or NULL if obj
+ *         is not such an array; no Python error is set
+ */
+static PyObject* latest_growable(PyObject *obj, int rows) {
+    PyObject *base;
+    GrowableMatrix *growable;
+
+    if (!PyArray_Check(obj)) {
+        return NULL;
+    }
+
+    base = PyArray_BASE((PyArrayObject *)obj);
+    if (base == NULL || !PyCapsule_IsValid(base, GROWABLE_CAPSULE_NAME)) {
+        return NULL;
+    }
+
+    growable = (GrowableMatrix *)PyCapsule_GetPointer(base, GROWABLE_CAPSULE_NAME);
+
+    return (growable->used == rows && (double *)PyArray_DATA((PyArrayObject *)obj) == growable->data) ? base : NULL;
+}
+
+
+/* 
+ * Convert a FloatMatrix struct to a 2-D float32 NumPy array, without copying 
+ * Input: matrix - FloatMatrix struct owning its storage; see convert_matrix_to_numpy
+ * Return: PyObject* - float32 array, or NULL with a Python error set
+ */
+static PyObject* convert_float_matrix_to_numpy(FloatMatrix matrix) {
+    npy_intp dims[2], strides[2];
+
+    dims[0] = matrix.rows;
+    dims[1] = matrix.cols;
+    strides[0] = (npy_intp)matrix.stride * sizeof(float);
+    strides[1] = sizeof(float);
+
+    return adopt_buffer(2, dims, strides, NPY_FLOAT32, matrix.data, matrix.block, BLOCK_CAPSULE_NAME);
+}
+
+
+/* 
+ * Convert a malloc'd array of doubles to a 1-D NumPy array, without copying 
+ * Input: values - array to convert; the NumPy array takes it over
+ *        size - number of elements
+ * Return: PyObject* - float64 array, or NULL with a Python error set
+ */
+static PyObject* convert_vector_to_numpy(double *values, int size) {
+    npy_intp dims[1];
+
+    dims[0] = size;
+
+    return adopt_buffer(1, dims, NULL, NPY_DOUBLE, values, values, BLOCK_CAPSULE_NAME);
+}
+
+
+/* 
+ * Convert a malloc'd array of ints to a 1-D NumPy array, without copying 
+ * Input: values - array to convert; the NumPy array takes it over
+ *        size - number of elements
+ * Return: PyObject* - int array, or NULL with a Python error set
+ */
+static PyObject* convert_indices_to_numpy(int *values, int size) {
+    npy_intp dims[1];
+
+    dims[0] = size;
+
+    return adopt_buffer(1, dims, NULL, NPY_INT, values, values, BLOCK_CAPSULE_NAME);
+}
+
+
+/* 
+ * Convert a SparseMatrix struct to a CSR triple of NumPy arrays, without copying 
+ * Input: matrix - SparseMatrix struct to convert (square); the arrays take
+ *        over its storage (it must not be freed afterwards, even on failure)
+ * Return: PyObject* - tuple (indptr, indices, data), laid out like
+ *         scipy.sparse.csr_matrix, or NULL with a Python error set
+ */
+static PyObject* convert_sparse_to_numpy(SparseMatrix matrix) {
+    PyObject *indptr = convert_indices_to_numpy(matrix.rowStart, matrix.rows + 1);
+    PyObject *indices = convert_indices_to_numpy(matrix.colIndex, matrix.nnz);
+    PyObject *data = convert_vector_to_numpy(matrix.values, matrix.nnz);
+
+    if (indptr == NULL || indices == NULL || data == NULL) {
+        Py_XDECREF(indptr);
+        Py_XDECREF(indices);
+        Py_XDECREF(data);
+        return NULL;
+    }
+
+    return Py_BuildValue("(NNN)", indptr, indices, data);
+}
+
+
+/* 
+ * Convert a Python CSR triple (indptr, indices, data) to a SparseMatrix struct 
+ * Input: obj - tuple as returned by convert_sparse_to_numpy
+ *        matrix - output; square, with len(indptr) - 1 rows
+ * Return: int - 0 on success, 1 with a Python error set otherwise
+ */
+static int convert_python_to_sparse(PyObject *obj, SparseMatrix *matrix) {
+    PyArrayObject *indptr = NULL, *indices = NULL, *data = NULL;
+    PyObject *indptr_obj, *indices_obj, *data_obj;
+    int rows, nnz, i, valid;
+
+    if (!PyArg_ParseTuple(obj, "OOO", &indptr_obj, &indices_obj, &data_obj)) {
+        return 1;
+    }
+
+    indptr = (PyArrayObject *)PyArray_FROM_OTF(indptr_obj, NPY_INT, NPY_ARRAY_IN_ARRAY);
+    indices = (PyArrayObject *)PyArray_FROM_OTF(indices_obj, NPY_INT, NPY_ARRAY_IN_ARRAY);
+    data = (PyArrayObject *)PyArray_FROM_OTF(data_obj, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY);
+
+    valid = (indptr != NULL && indices != NULL && data != NULL &&
+             PyArray_NDIM(indptr) == 1 && PyArray_NDIM(indices) == 1 && PyArray_NDIM(data) == 1 &&
+             PyArray_DIM(indptr, 0) > 0 && PyArray_DIM(indices, 0) == PyArray_DIM(data, 0));
+
+    if (valid) {
+        rows = (int)PyArray_DIM(indptr, 0) - 1;
+        nnz = (int)PyArray_DIM(data, 0);
+        *matrix = createSparseMatrix(rows, rows, nnz);
+
+        memcpy(matrix->rowStart, PyArray_DATA(indptr), ((size_t)rows + 1) * sizeof(int));
+        memcpy(matrix->colIndex, PyArray_DATA(indices), (size_t)nnz * sizeof(int));
+        memcpy(matrix->values, PyArray_DATA(data), (size_t)nnz * sizeof(double));
+
+        /* Reject structures that would index outside the arrays. */
+        valid = (matrix->rowStart[0] == 0 && matrix->rowStart[rows] == nnz);
+        for (i = 0; valid && i < rows; i++) {
+            valid = (matrix->rowStart[i] <= matrix->rowStart[i + 1]);
+        }
+        for (i = 0; valid && i < nnz; i++) {
+            valid = (matrix->colIndex[i] >= 0 && matrix->colIndex[i] < rows);
+        }
+
+        if (!valid) {
+            freeSparseMatrix(*matrix);
+        }
+    }
+
+    Py_XDECREF(indptr);
+    Py_XDECREF(indices);
+    Py_XDECREF(data);
+
+    if (!valid) {
+        PyErr_SetString(PyExc_ValueError, "An Error Has Occurred");
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/* The inputs of a converge_H call, viewed in place. */
+typedef struct {
+    PyArrayObject *h_array;  /* Array backing h_matrix */
+    PyArrayObject *w_array;  /* Array backing w_matrix or w_single; NULL for a sparse W */
+    Matrix h_matrix;         /* Initial H (n x k) */
+    Matrix w_matrix;         /* Dense W (n x n) */
+    FloatMatrix w_single;    /* Dense W (n x n) in single precision */
+    SparseMatrix w_sparse;   /* Sparse W (n x n), copied from the CSR triple */
+    int is_sparse;
+    int is_single;
+} ConvergeInputs;
+
+
+/* 
+ * Convert the H and W arguments of converge_h_c 
+ * Input: h_obj - initial H, 2-D array-like (n x k)
+ *        w_obj - W, 2-D array-like (n x n) or (indptr, indices, data) tuple;
+ *                a float32 array is used in single precision as it is
+ *        inputs - output; release with release_converge_inputs
+ * Return: int - 0 on success, 1 with a Python error set otherwise
+ */
+static int convert_converge_inputs(PyObject *h_obj, PyObject *w_obj, ConvergeInputs *inputs) {
+    int w_rows, w_cols;
+
+    /* A tuple W is a sparse matrix in (indptr, indices, data) form. */
+    inputs->is_sparse = PyTuple_Check(w_obj);
+    inputs->is_single = (PyArray_Check(w_obj) && PyArray_TYPE((PyArrayObject *)w_obj) == NPY_FLOAT32);
+    inputs->w_array = NULL;
+
+    inputs->h_array = convert_numpy_to_matrix(h_obj, &inputs->h_matrix);
+    if (inputs->h_array == NULL) {
+        return 1;
+    }
+
+    if (inputs->is_sparse) {
+        if (convert_python_to_sparse(w_obj, &inputs->w_sparse) != 0) {
+            Py_DECREF(inputs->h_array);
+            return 1;
+        }
+        w_rows = w_cols = inputs->w_sparse.rows;
+    }
+    else {
+        inputs->w_array = inputs->is_single ? convert_numpy_to_float_matrix(w_obj, &inputs->w_single)
+                                            : convert_numpy_to_matrix(w_obj, &inputs->w_matrix);
+        if (inputs->w_array == NULL) {
+            Py_DECREF(inputs->h_array);
+            return 1;
+        }
+        w_rows = inputs->is_single ? inputs->w_single.rows : inputs->w_matrix.rows;
+        w_cols = inputs->is_single ? inputs->w_single.cols : inputs->w_matrix.cols;
+    }
+
+    if (w_rows != inputs->h_matrix.rows || w_cols != inputs->h_matrix.rows) {
+        PyErr_SetString(PyExc_ValueError, "An Error Has Occurred");
+        if (inputs->is_sparse) {
+            freeSparseMatrix(inputs->w_sparse);
+        }
+        Py_DECREF(inputs->h_array);
+        Py_XDECREF(inputs->w_array);
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/* Release what convert_converge_inputs acquired; needs the GIL. */
+static void release_converge_inputs(ConvergeInputs *inputs) {
+    if (inputs->is_sparse) {
+        freeSparseMatrix(inputs->w_sparse);
+    }
+    Py_DECREF(inputs->h_array);
+    Py_XDECREF(inputs->w_array);
+}
+
+
+/* 
+ * Fill the solver settings of converge_h_c and symnmf_c 
+ * Input: solver, stop - names; see parseSolverOptions
+ *        beta - damping or step scale, in (0, 1]
+ *        patience - stable iterations for stop='labels', at least 1
+ *        options - output
+ * Return: int - 0 on success, 1 with a Python error set otherwise
+ */
+static int convert_solver_options(const char *solver, const char *stop, double beta, int patience,
+                                  SolverOptions *options) {
+    if (parseSolverOptions(solver, stop, options) != 0 || !(beta > 0.0 && beta <= 1.0) || patience < 1) {
+        PyErr_SetString(PyExc_ValueError, "An Error Has Occurred");
+        return 1;
+    }
+    options->beta = beta;
+    options->patience = patience;
+
+    return 0;
+}
+
+
+/* Pick the product for the W of converted inputs and, when the solve needs
+ * it, fill in its squared norm for the objective; reported is as in
+ * solverNeedsWeightNorm. Touches no Python object. */
+static WeightProduct select_product(ConvergeInputs *inputs, SolverOptions *options, int reported,
+                                    const void **weights) {
+    int needed = solverNeedsWeightNorm(options, reported);
+
+    if (inputs->is_sparse) {
+        options->weightNorm = needed ? squaredNormSparseMatrix(inputs->w_sparse) : 0.0;
+        *weights = &inputs->w_sparse;
+        return sparseWeightProduct;
+    }
+    if (inputs->is_single) {
+        options->weightNorm = needed ? squaredNormFloatMatrix(inputs->w_single) : 0.0;
+        *weights = &inputs->w_single;
+        return singleWeightProduct;
+    }
+    options->weightNorm = needed ? squaredNormMatrix(inputs->w_matrix) : 0.0;
+    *weights = &inputs->w_matrix;
+    return denseWeightProduct;
+}
+
+
+/* Run converge_H on converted inputs; reported is as in select_product.
+ * Touches no Python object, so it can run without the GIL. */
+static Matrix run_converge(ConvergeInputs *inputs, SolverOptions *options, int reported, ConvergeControl *control) {
+    const void *weights;
+    WeightProduct product = select_product(inputs, options, reported, &weights);
+
+    return convergeHSolve(product, weights, inputs->h_matrix, options, control);
+}
+
+
+/* 
+ * Python wrapper function to iteratively update H matrix until convergence 
+ * The iterations run without the GIL.
+ * Input: H - initial H matrix (n x k)
+ *        W - weight matrix (n x n)
+ *        eps - convergence threshold. def = 0.0001
+ *        iter - maximum number of iterations. def = 300
+ *        solver - 'multiplicative' (default), 'adaptive', 'nesterov' or
+ *                 'gradient'; see convergeHSolve
+ *        stop - 'change' (default), 'objective' or 'labels'
+ *        beta - damping of the multiplicative rules or gradient step scale
+ *        patience - iterations the labels must stay unchanged for 'labels'
+ *        trajectory - also return the objective of every iteration
+ * Return: PyObject* - converged H matrix (n x k) as a NumPy array; with
+ *         trajectory, the tuple (H, objectives), whose length is the
+ *         number of iterations run
+ */
+static PyObject* converge_h_c(PyObject* self, PyObject* args, PyObject* kwargs) {
+    static char *kwlist[] = {"H", "W", "eps", "iter", "threads", "solver", "stop", "beta", "patience",
+                             "trajectory", NULL};
+    ConvergeInputs inputs;
+    ConvergeControl control = {0, 0, 0.0, 0.0, 0};
+    SolverOptions options = defaultSolverOptions();
+    Matrix result_matrix;
+    PyObject *h_obj, *w_obj, *result_obj, *objectives_obj;
+    const char *solver = "multiplicative";
+    const char *stop = "change";
+    double beta = options.beta;
+    int patience = options.patience;
+    int threads = 0;
+    int trajectory = 0;
+    
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOdi|issdip", kwlist, &h_obj, &w_obj, &options.eps,
+                                     &options.iter, &threads, &solver, &stop, &beta, &patience, &trajectory)) {
+        return NULL;
+    }
+
+    if (convert_solver_options(solver, stop, beta, patience, &options) != 0) {
+        return NULL;
+    }
+
+    if (trajectory) {
+        options.objectives = (double *)malloc(((size_t)(options.iter > 0 ? options.iter : 0) + 1) * sizeof(double));
+        if (options.objectives == NULL) {
+            return PyErr_NoMemory();
+        }
+    }
+
+    if (convert_converge_inputs(h_obj, w_obj, &inputs) != 0) {
+        free(options.objectives);
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    setNumThreads(threads);
+    result_matrix = run_converge(&inputs, &options, 0, &control);
+    setNumThreads(0);
+    Py_END_ALLOW_THREADS
+
+    release_converge_inputs(&inputs);
+
+    if (result_matrix.data == NULL) {
+        free(options.objectives);
+        PyErr_SetString(PyExc_RuntimeError, "An Error Has Occurred");
+        return NULL;
+    }
+
+    result_obj = convert_matrix_to_numpy(result_matrix);
+    if (!trajectory || result_obj == NULL) {
+        free(options.objectives);
+        return result_obj;
+    }
+
+    objectives_obj = convert_vector_to_numpy(options.objectives, control.iterations);
+    if (objectives_obj == NULL) {
+        Py_DECREF(result_obj);
+        return NULL;
+    }
+
+    return Py_BuildValue("NN", result_obj, objectives_obj);
+}
+
+
+/* 
+ * Python wrapper function to converge several initial H matrices against
+ * one W and keep the best 
+ * All restarts share W and advance together, one wide W * H product per
+ * iteration (see convergeHRestarts); the iterations run without the GIL.
+ * Input: Hs - sequence of initial H matrices (n x k each), such as a list
+ *             or an (R, n, k) array
+ *        W and the other arguments - as converge_h_c, without trajectory
+ * Return: PyObject* - the tuple (H, scores): the converged H with the
+ *         smallest objective and the objective of every restart
+ */
+static PyObject* converge_h_restarts(PyObject* self, PyObject* args, PyObject* kwargs) {
+    static char *kwlist[] = {"Hs", "W", "eps", "iter", "threads", "solver", "stop", "beta", "patience", NULL};
+    ConvergeInputs inputs;
+    SolverOptions options = defaultSolverOptions();
+    WeightProduct product;
+    const void *weights;
+    Matrix *h_matrices;
+    PyArrayObject **h_arrays;
+    Matrix result_matrix;
+    PyObject *hs_obj, *w_obj, *sequence, *result_obj, *scores_obj;
+    const char *solver = "multiplicative";
+    const char *stop = "change";
+    double beta = options.beta;
+    double *scores;
+    int patience = options.patience;
+    int threads = 0;
+    Py_ssize_t restarts, r, converted = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOdi|issdi", kwlist, &hs_obj, &w_obj, &options.eps,
+                                     &options.iter, &threads, &solver, &stop, &beta, &patience)) {
+        return NULL;
+    }
+
+    if (convert_solver_options(solver, stop, beta, patience, &options) != 0) {
+        return NULL;
+    }
+
+    sequence = PySequence_Fast(hs_obj, "An Error Has Occurred");
+    if (sequence == NULL) {
+        return NULL;
+    }
+
+    restarts = PySequence_Fast_GET_SIZE(sequence);
+    if (restarts < 1 || restarts > INT_MAX) {
+        Py_DECREF(sequence);
+        PyErr_SetString(PyExc_ValueError, "An Error Has Occurred");
+        return NULL;
+    }
+
+    /* The first H is checked against W; the others must match it. */
+    if (convert_converge_inputs(PySequence_Fast_GET_ITEM(sequence, 0), w_obj, &inputs) != 0) {
+        Py_DECREF(sequence);
+        return NULL;
+    }
+
+    h_matrices = (Matrix *)PyMem_Malloc((size_t)restarts * sizeof(Matrix));
+    h_arrays = (PyArrayObject **)PyMem_Malloc((size_t)restarts * sizeof(PyArrayObject *));
+    scores = (double *)malloc((size_t)restarts * sizeof(double));
+
+    if (h_matrices == NULL || h_arrays == NULL || scores == NULL) {
+        PyErr_NoMemory();
+    }
+    else {
+        h_matrices[0] = inputs.h_matrix;
+        for (converted = 1; converted < restarts; converted++) {
+            h_arrays[converted] = convert_numpy_to_matrix(PySequence_Fast_GET_ITEM(sequence, converted),
+                                                          &h_matrices[converted]);
+            if (h_arrays[converted] == NULL) {
+                break;
+            }
+            if (h_matrices[converted].rows != inputs.h_matrix.rows ||
+                h_matrices[converted].cols != inputs.h_matrix.cols) {
+                Py_DECREF(h_arrays[converted]);
+                PyErr_SetString(PyExc_ValueError, "An Error Has Occurred");
+                break;
+            }
+        }
+    }
+
+    result_matrix.data = NULL;
+    if (converted == restarts) {
+        Py_BEGIN_ALLOW_THREADS
+        setNumThreads(threads);
+        product = select_product(&inputs, &options, 1, &weights);
+        result_matrix = convergeHRestarts(product, weights, h_matrices, (int)restarts, &options, scores);
+        setNumThreads(0);
+        Py_END_ALLOW_THREADS
+    }
+
+    for (r = 1; r < converted; r++) {
+        Py_DECREF(h_arrays[r]);
+    }
+    release_converge_inputs(&inputs);
+    Py_DECREF(sequence);
+    PyMem_Free(h_matrices);
+    PyMem_Free(h_arrays);
+
+    if (result_matrix.data == NULL) {
+        free(scores);
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_RuntimeError, "An Error Has Occurred");
+        }
+        return NULL;
+    }
+
+    result_obj = convert_matrix_to_numpy(result_matrix);
+    if (result_obj == NULL) {
+        free(scores);
+        return NULL;
+    }
+
+    scores_obj = convert_vector_to_numpy(scores, (int)restarts);
+    if (scores_obj == NULL) {
+        Py_DECREF(result_obj);
+        return NULL;
+    }
+
+    return Py_BuildValue("NN", result_obj, scores_obj);
+}
+
+
+/* 
+ * Python wrapper function to add data points to a factorization 
+ * Only the similarities of the new points are computed, and H is
+ * warm-started from the previous one; see extendSymnmf. The work runs
+ * without the GIL.
+ * Input: X - previous data points (n x d)
+ *        A - their similarity matrix (n x n), as from symnmf_c('sym', X)
+ *        D - their degrees (n), as from symnmf_c('ddg', X)
+ *        H - their converged H (n x k)
+ *        X_new - the new data points (m x d)
+ *        eps, iter, threads, solver, stop - as converge_h_c
+ *        capacity - points that new storage of X and A has room for
+ * Return: PyObject* - the tuple (X, A, D, H) for all n + m points, ready
+ *         for the next call. When X and A came from the previous call
+ *         unchanged and have room, they grow in place: the arrays passed
+ *         in keep their contents, and the new ones share their storage.
+ */
+static PyObject* extend_symnmf_c(PyObject* self, PyObject* args, PyObject* kwargs) {
+    static char *kwlist[] = {"X", "A", "D", "H", "X_new", "eps", "iter", "threads", "solver", "stop", "capacity",
+                             NULL};
+    SolverOptions options = defaultSolverOptions();
+    SymnmfModel previous, model;
+    Matrix x_new;
+    PyObject *x_obj, *a_obj, *d_obj, *h_obj, *x_new_obj;
+    PyObject *x_out, *a_out, *d_out, *h_out;
+    PyObject *x_growable = NULL, *a_growable = NULL;
+    PyArrayObject *arrays[5] = {NULL, NULL, NULL, NULL, NULL};
+    const char *solver = "multiplicative";
+    const char *stop = "change";
+    int threads = 0;
+    int capacity = 0;
+    int failed, i;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOOOO|diissi", kwlist, &x_obj, &a_obj, &d_obj, &h_obj,
+                                     &x_new_obj, &options.eps, &options.iter, &threads, &solver, &stop,
+                                     &capacity)) {
+        return NULL;
+    }
+
+    if (convert_solver_options(solver, stop, options.beta, options.patience, &options) != 0) {
+        return NULL;
+    }
+
+    arrays[0] = convert_numpy_to_data(x_obj, &previous.X);
+    arrays[1] = (arrays[0] != NULL) ? convert_numpy_to_matrix(a_obj, &previous.A) : NULL;
+    arrays[2] = (arrays[1] != NULL) ? (PyArrayObject *)PyArray_FROM_OTF(d_obj, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY) : NULL;
+    arrays[3] = (arrays[2] != NULL) ? convert_numpy_to_matrix(h_obj, &previous.H) : NULL;
+    arrays[4] = (arrays[3] != NULL) ? convert_numpy_to_data(x_new_obj, &x_new) : NULL;
+
+    failed = (arrays[4] == NULL);
+    if (!failed) {
+        previous.D.size = (int)PyArray_SIZE(arrays[2]);
+        previous.D.values = (double *)PyArray_DATA(arrays[2]);
+
+        failed = (PyArray_NDIM(arrays[2]) != 1 || previous.X.rows < 1 || previous.D.size != previous.X.rows ||
+                  previous.A.rows != previous.X.rows || previous.A.cols != previous.X.rows ||
+                  previous.H.rows != previous.A.rows || previous.H.cols < 1 ||
+                  x_new.cols != previous.X.cols || x_new.rows < 1 || x_new.rows > INT_MAX - previous.X.rows);
+        if (failed) {
+            PyErr_SetString(PyExc_ValueError, "An Error Has Occurred");
+        }
+    }
+
+    if (!failed) {
+        /* X and A grow in place only if both are the latest model in storage with room; the storage is
+         * claimed before the GIL is released, so no other call can grow it too. */
+        previous.capacity = previous.X.rows;
+        x_growable = latest_growable(x_obj, previous.X.rows);
+        a_growable = latest_growable(a_obj, previous.A.rows);
+        if (x_growable != NULL && a_growable != NULL && x_growable != a_growable) {
+            GrowableMatrix *x_storage = (GrowableMatrix *)PyCapsule_GetPointer(x_growable, GROWABLE_CAPSULE_NAME);
+            GrowableMatrix *a_storage = (GrowableMatrix *)PyCapsule_GetPointer(a_growable, GROWABLE_CAPSULE_NAME);
+
+            if (x_storage->capacity == a_storage->capacity &&
+                x_storage->capacity - previous.X.rows >= x_new.rows) {
+                previous.capacity = x_storage->capacity;
+                x_storage->used = a_storage->used = previous.X.rows + x_new.rows;
+                Py_INCREF(x_growable);
+                Py_INCREF(a_growable);
+            }
+        }
+        if (previous.capacity == previous.X.rows) {
+            x_growable = a_growable = NULL;
+        }
+
+        Py_BEGIN_ALLOW_THREADS
+        setNumThreads(threads);
+        model = extendSymnmf(&previous, x_new, options, capacity);
+        setNumThreads(0);
+        Py_END_ALLOW_THREADS
+    }
+
+    for (i = 0; i < 5; i++) {
+        Py_XDECREF(arrays[i]);
+    }
+
+    if (failed) {
+        return NULL;
+    }
+
+    x_out = convert_growable_to_numpy(model.X, model.capacity, x_growable);
+    a_out = convert_growable_to_numpy(model.A, model.capacity, a_growable);
+    Py_XDECREF(x_growable);
+    Py_XDECREF(a_growable);
+    d_out = convert_vector_to_numpy(model.D.values, model.D.size);
+    h_out = convert_matrix_to_numpy(model.H);
+    if (x_out == NULL || a_out == NULL || d_out == NULL || h_out == NULL) {
+        Py_XDECREF(x_out);
+        Py_XDECREF(a_out);
+        Py_XDECREF(d_out);
+        Py_XDECREF(h_out);
+        return NULL;
+    }
+
+    return Py_BuildValue("(NNNN)", x_out, a_out, d_out, h_out);
+}
+
+
+/* A converge_H call running on its own thread; see converge_h_async. */
+typedef struct {
+    PyObject_HEAD
+    ConvergeInputs inputs;
+    SolverOptions options;
+    int threads;
+    ConvergeControl control;   /* Progress and cancellation, shared with the worker */
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+    int started;               /* The worker thread was created */
+    int done;                  /* The worker has stored result; guarded by lock */
+    int joined;                /* The worker thread was joined */
+    Matrix result;             /* Owned until result() hands it to NumPy */
+    PyObject *result_obj;      /* The NumPy array returned by result() */
+} ConvergeFuture;
+
+static PyTypeObject ConvergeFutureType = {PyVarObject_HEAD_INIT(NULL, 0)};
+
+
+/* Worker thread of a ConvergeFuture; runs without the GIL. */
+static void* converge_future_run(void *arg) {
+    ConvergeFuture *future = (ConvergeFuture *)arg;
+    Matrix result;
+
+    setNumThreads(future->threads);
+    result = run_converge(&future->inputs, &future->options, 1, &future->control);
+
+    pthread_mutex_lock(&future->lock);
+    future->result = result;
+    future->done = 1;
+    pthread_cond_broadcast(&future->finished);
+    pthread_mutex_unlock(&future->lock);
+
+    return NULL;
+}
+
+
+/* 
+ * Wait for the worker of a future, without the GIL 
+ * Input: future - the future to wait for
+ *        seconds - longest time to wait
+ * Return: int - nonzero if the worker has finished
+ */
+static int wait_converge_future(ConvergeFuture *future, double seconds) {
+    struct timespec deadline;
+    int done, rc = 0;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += (time_t)seconds;
+    deadline.tv_nsec += (long)((seconds - (double)(time_t)seconds) * 1e9);
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&future->lock);
+    while (!future->done && rc != ETIMEDOUT) {
+        rc = pthread_cond_timedwait(&future->finished, &future->lock, &deadline);
+    }
+    done = future->done;
+    pthread_mutex_unlock(&future->lock);
+
+    return done;
+}
+
+
+/* Join the worker thread once; needs the GIL, which it releases meanwhile. */
+static void join_converge_future(ConvergeFuture *future) {
+    if (future->started && !future->joined) {
+        Py_BEGIN_ALLOW_THREADS
+        pthread_join(future->thread, NULL);
+        Py_END_ALLOW_THREADS
+        future->joined = 1;
+    }
+}
+
+
+static void converge_future_dealloc(ConvergeFuture *self) {
+    /* Nobody can collect the result any more: stop the worker early. */
+    if (self->started) {
+        cancelConvergence(&self->control);
+        join_converge_future(self);
+        if (self->result_obj == NULL) {
+            freeMatrix(self->result);
+        }
+        release_converge_inputs(&self->inputs);
+        pthread_mutex_destroy(&self->lock);
+        pthread_cond_destroy(&self->finished);
+    }
+    Py_XDECREF(self->result_obj);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+
+/* future.done(): whether the iterations have finished. */
+static PyObject* converge_future_done(ConvergeFuture *self, PyObject *unused) {
+    int done;
+
+    pthread_mutex_lock(&self->lock);
+    done = self->done;
+    pthread_mutex_unlock(&self->lock);
+
+    return PyBool_FromLong(done);
+}
+
+
+/* future.cancel(): stop before the next iteration; False if already finished. */
+static PyObject* converge_future_cancel(ConvergeFuture *self, PyObject *unused) {
+    int done;
+
+    pthread_mutex_lock(&self->lock);
+    done = self->done;
+    if (!done) {
+        cancelConvergence(&self->control);
+    }
+    pthread_mutex_unlock(&self->lock);
+
+    return PyBool_FromLong(!done);
+}
+
+
+/* future.cancelled(): whether cancel() stopped the iterations. False while
+ * they are still running, and when cancel() came after the last iteration. */
+static PyObject* converge_future_cancelled(ConvergeFuture *self, PyObject *unused) {
+    int cancelled;
+
+#pragma omp atomic read
+    cancelled = self->control.stopped;
+
+    return PyBool_FromLong(cancelled);
+}
+
+
 /* 
- * Convert a NumPy array to a Matrix struct 
- * Input: array - NumPy array to convert
- * Return: Matrix - Converted Matrix struct
+ * future.result(timeout=None): wait for the iterations to finish 
+ * The wait is done in short slices without the GIL, so other threads keep
+ * running and signals such as KeyboardInterrupt are still handled.
+ * Input: timeout - longest time to wait in seconds; None waits forever
+ * Return: PyObject* - H (n x k) as a NumPy array, the same object on every
+ *         call; after cancel() the last completed iterate. TimeoutError if
+ *         the iterations are still running when the timeout expires.
  */
-static Matrix convert_numpy_to_matrix(PyArrayObject *array) {
-    int rows = (int)PyArray_DIM(array, 0);
-    int cols = (int)PyArray_DIM(array, 1);
-    Matrix matrix;
-    int i, j;
-
-    matrix.rows = rows;
-    matrix.cols = cols;
-    matrix.data = (double **)malloc(rows * sizeof(double *));
+static PyObject* converge_future_result(ConvergeFuture *self, PyObject *args, PyObject *kwargs) {
+    static char *kwlist[] = {"timeout", NULL};
+    PyObject *timeout_obj = Py_None;
+    double remaining = -1.0, slice;
+    int done = 0;
 
-    if (matrix.data == NULL) {
-        PyErr_SetString(PyExc_RuntimeError, "An Error Has Occurred");
-        matrix.rows = 0;
-        matrix.cols = 0;
-        return matrix;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|O", kwlist, &timeout_obj)) {
+        return NULL;
     }
 
-    for (i = 0; i < rows; ++i) {
-        matrix.data[i] = (double *)malloc(cols * sizeof(double));
+    if (timeout_obj != Py_None) {
+        remaining = PyFloat_AsDouble(timeout_obj);
+        if (remaining == -1.0 && PyErr_Occurred()) {
+            return NULL;
+        }
+        remaining = (remaining > 0.0) ? remaining : 0.0;
+    }
 
-        if (matrix.data[i] == NULL) {
-            PyErr_SetString(PyExc_RuntimeError, "An Error Has Occurred");
+    while (!done) {
+        slice = (remaining < 0.0 || remaining > 0.1) ? 0.1 : remaining;
 
-            /* Clean up allocated memory before returning */
-            for (j = 0; j < i; ++j) {
-                free(matrix.data[j]);
-            }
+        Py_BEGIN_ALLOW_THREADS
+        done = wait_converge_future(self, slice);
+        Py_END_ALLOW_THREADS
 
-            free(matrix.data);
+        if (!done && remaining >= 0.0 && (remaining -= slice) <= 0.0) {
+            PyErr_SetString(PyExc_TimeoutError, "An Error Has Occurred");
+            return NULL;
+        }
+        if (!done && PyErr_CheckSignals() != 0) {
+            return NULL;
+        }
+    }
 
-            matrix.rows = 0;
-            matrix.cols = 0;
+    if (self->result_obj == NULL) {
+        join_converge_future(self);
 
-            return matrix;
+        if (self->result.data == NULL) {
+            PyErr_SetString(PyExc_RuntimeError, "An Error Has Occurred");
+            return NULL;
         }
 
-        /* Copy data from NumPy array to Matrix struct */
-        for (j = 0; j < cols; ++j) {
-            matrix.data[i][j] = *(double *)PyArray_GETPTR2(array, i, j);
+        self->result_obj = convert_matrix_to_numpy(self->result);
+        self->result.block = NULL;
+        self->result.data = NULL;
+
+        if (self->result_obj == NULL) {
+            return NULL;
         }
     }
-    return matrix;
+
+    Py_INCREF(self->result_obj);
+    return self->result_obj;
+}
+
+
+/* future.iterations: iterations completed so far. */
+static PyObject* converge_future_iterations(ConvergeFuture *self, void *closure) {
+    return PyLong_FromLong(convergenceProgress(&self->control, NULL));
+}
+
+
+/* future.change: Frobenius norm of the last update of H. */
+static PyObject* converge_future_change(ConvergeFuture *self, void *closure) {
+    double change;
+
+    convergenceProgress(&self->control, &change);
+
+    return PyFloat_FromDouble(change);
+}
+
+
+/* future.objective: objective of the point the last update started from. */
+static PyObject* converge_future_objective(ConvergeFuture *self, void *closure) {
+    double objective;
+
+#pragma omp atomic read
+    objective = self->control.objective;
+
+    return PyFloat_FromDouble(objective);
+}
+
+
+static PyMethodDef converge_future_methods[] = {
+    {"done", (PyCFunction)converge_future_done, METH_NOARGS, "Return True if the iterations have finished."},
+    {"cancel", (PyCFunction)converge_future_cancel, METH_NOARGS, "Stop before the next iteration; False if already finished."},
+    {"cancelled", (PyCFunction)converge_future_cancelled, METH_NOARGS, "Return True if cancel() stopped the iterations."},
+    {"result", (PyCFunction)(void (*)(void))converge_future_result, METH_VARARGS | METH_KEYWORDS, "Wait for and return H; result(timeout=None)."},
+    {NULL, NULL, 0, NULL}
+};
+
+
+static PyGetSetDef converge_future_getset[] = {
+    {"iterations", (getter)converge_future_iterations, NULL, "Iterations completed so far.", NULL},
+    {"change", (getter)converge_future_change, NULL, "Frobenius norm of the last update of H.", NULL},
+    {"objective", (getter)converge_future_objective, NULL, "Objective of the point the last update started from.", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+
+/* 
+ * Copy an H or W argument of converge_h_async into a new array 
+ * The worker reads H and W without the GIL while the caller keeps running,
+ * so it gets storage the caller cannot write to. A sparse W (a tuple) is
+ * passed on, since convert_python_to_sparse copies it anyway.
+ * Return: PyObject* - a new reference, or NULL with a Python error set
+ */
+static PyObject* copy_async_argument(PyObject *obj) {
+    if (PyTuple_Check(obj)) {
+        Py_INCREF(obj);
+        return obj;
+    }
+
+    return PyArray_FROM_OF(obj, NPY_ARRAY_CARRAY | NPY_ARRAY_ENSURECOPY);
 }
 
 
 /* 
- * Convert a Matrix struct to a Python list of lists 
- * Input: outputMatrix - Matrix struct to convert
- * Return: PyObject* - Python list of lists representing the matrix
+ * Python wrapper function to start converge_H on a background thread 
+ * H and W are copied first, so the caller may change its arrays while the
+ * iterations run; converge_h_c uses them in place instead.
+ * Input: as converge_h_c, without trajectory
+ * Return: PyObject* - a ConvergeFuture; poll it with done(), iterations
+ *         and objective, stop it with cancel() and collect H with result()
  */
-static PyObject* convert_matrix_to_python(Matrix outputMatrix) {
-    PyObject *pyOutputMatrixObj = PyList_New(outputMatrix.rows);
-    int i, j, k;
+static PyObject* converge_h_async(PyObject* self, PyObject* args, PyObject* kwargs) {
+    static char *kwlist[] = {"H", "W", "eps", "iter", "threads", "solver", "stop", "beta", "patience", NULL};
+    ConvergeFuture *future;
+    SolverOptions options = defaultSolverOptions();
+    PyObject *h_obj, *w_obj, *h_copy, *w_copy;
+    const char *solver = "multiplicative";
+    const char *stop = "change";
+    double beta = options.beta;
+    int patience = options.patience;
+    int threads = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOdi|issdi", kwlist, &h_obj, &w_obj, &options.eps,
+                                     &options.iter, &threads, &solver, &stop, &beta, &patience)) {
+        return NULL;
+    }
+
+    if (convert_solver_options(solver, stop, beta, patience, &options) != 0) {
+        return NULL;
+    }
+
+    future = PyObject_New(ConvergeFuture, &ConvergeFutureType);
+    if (future == NULL) {
+        return NULL;
+    }
+
+    future->started = 0;
+    future->result_obj = NULL;
+
+    h_copy = copy_async_argument(h_obj);
+    w_copy = (h_copy != NULL) ? copy_async_argument(w_obj) : NULL;
+    if (w_copy == NULL || convert_converge_inputs(h_copy, w_copy, &future->inputs) != 0) {
+        Py_XDECREF(h_copy);
+        Py_XDECREF(w_copy);
+        Py_DECREF(future);
+        return NULL;
+    }
+    /* The inputs hold their own references to the copies. */
+    Py_DECREF(h_copy);
+    Py_DECREF(w_copy);
+
+    future->options = options;
+    future->threads = threads;
+    future->control.cancelled = 0;
+    future->control.iterations = 0;
+    future->control.change = 0.0;
+    future->control.objective = 0.0;
+    future->control.stopped = 0;
+    future->done = 0;
+    future->joined = 0;
+    future->result.data = NULL;
+    future->result.block = NULL;
+    pthread_mutex_init(&future->lock, NULL);
+    pthread_cond_init(&future->finished, NULL);
 
-    if (!pyOutputMatrixObj) {
+    if (pthread_create(&future->thread, NULL, converge_future_run, future) != 0) {
+        pthread_mutex_destroy(&future->lock);
+        pthread_cond_destroy(&future->finished);
+        release_converge_inputs(&future->inputs);
+        Py_DECREF(future);
         PyErr_SetString(PyExc_RuntimeError, "An Error Has Occurred");
         return NULL;
     }
-    
-    for (i = 0; i < outputMatrix.rows; ++i) {
-        PyObject *pyRow = PyList_New(outputMatrix.cols);
-        
-        if (!pyRow) {
-            /* Clean up if creating a row list fails */
-            Py_DECREF(pyOutputMatrixObj);
-            PyErr_SetString(PyExc_RuntimeError, "An Error Has Occurred");
+    future->started = 1;
+
+    return (PyObject *)future;
+}
+
+
+/* 
+ * Python wrapper function for SymNMF operations 
+ * The computation runs without the GIL.
+ * Input: goal - the desired operation ('symnmf', 'sym', 'ddg', 'norm', 'symknn')
+ *        x - data matrix
+ *        knn, radius - with knn > 0, radius > 0 or goal 'symknn', work on the
+ *                      sparse similarity graph (see symKnn)
+ *        k, eps, iter, seed - for 'symnmf': number of clusters (required),
+ *                             convergence threshold, maximum number of
+ *                             iterations and seed of the initial H
+ *        precision - 'double' or 'single': storage of the dense n x n
+ *                    matrices; 'single' returns float32 arrays for 'sym'
+ *                    and 'norm', which converge_h_c accepts as they are
+ *        scratch - path of a scratch file: the dense goals are computed out
+ *                  of core (see symOutOfCore), 'sym' and 'norm' return an
+ *                  array over the file mapping, and 'symnmf' streams W
+ *        weights - 'dense' or 'implicit': 'implicit' makes 'symnmf'
+ *                  recompute W from x in every iteration instead of
+ *                  storing it (see implicitWeightProduct)
+ *        solver, stop - how 'symnmf' converges H; see converge_h_c
+ *        restarts - for 'symnmf': initial H matrices (seeds seed to
+ *                   seed + restarts - 1) run together; the best is kept
+ * Return: PyObject* - resulting matrix as a NumPy array that owns the C result.
+ *         For 'ddg' this is the 1-D array of diagonal entries (the degrees);
+ *         sparse results are (indptr, indices, data) CSR triples of arrays.
+ *         For 'symnmf' it is the tuple (labels, H, scores) of the full
+ *         factorization, which never leaves C until it is done; scores holds
+ *         the objective of every restart, one entry without restarts.
+ */
+static PyObject* symnmf_c(PyObject* self, PyObject* args, PyObject* kwargs) {
+    static char *kwlist[] = {"goal", "x", "threads", "knn", "radius", "k", "eps", "iter", "seed", "precision",
+                             "scratch", "weights", "solver", "stop", "restarts", NULL};
+    char *goal;
+    char *precision_name = "double";
+    char *weights_name = "dense";
+    const char *solver = "multiplicative";
+    const char *stop = "change";
+    SymnmfOptions options = defaultSymnmfOptions();
+    MappedMatrix *mapped = NULL;
+    npy_intp dims[2], strides[2];
+    int failed = 0;
+    int threads = 0;
+    int neighbours = 0;
+    double radius = 0.0;
+    int clusters = 0;
+    int is_sparse, is_ddg, is_norm;
+    PyObject *x_obj, *labels_obj, *h_obj, *scores_obj;
+    PyArrayObject *x_array;
+    Matrix x_matrix, outputMatrix, sym_matrix;
+    FloatMatrix outputSingle;
+    SparseMatrix outputSparse, sym_sparse;
+    DiagMatrix ddg_matrix;
+    int *labels;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sO|iididikszsssi", kwlist, &goal, &x_obj, &threads, &neighbours,
+                                     &radius, &clusters, &options.solver.eps, &options.solver.iter,
+                                     &options.seed, &precision_name, &options.scratchFile, &weights_name,
+                                     &solver, &stop, &options.restarts)) {
+        return NULL;
+    }
+
+    if (convert_solver_options(solver, stop, options.solver.beta, options.solver.patience, &options.solver) != 0) {
+        return NULL;
+    }
+    if (options.restarts < 1) {
+        PyErr_SetString(PyExc_ValueError, "An Error Has Occurred");
+        return NULL;
+    }
+
+    if ((strcmp(precision_name, "double") != 0 && strcmp(precision_name, "single") != 0) ||
+        (strcmp(weights_name, "dense") != 0 && strcmp(weights_name, "implicit") != 0)) {
+        PyErr_SetString(PyExc_ValueError, "An Error Has Occurred");
+        return NULL;
+    }
+    options.precision = (strcmp(precision_name, "single") == 0) ? PRECISION_SINGLE : PRECISION_DOUBLE;
+    options.implicit = (strcmp(weights_name, "implicit") == 0);
+
+    is_sparse = (strcmp(goal, "symknn") == 0 || neighbours > 0 || radius > 0.0);
+    is_ddg = (strcmp(goal, "ddg") == 0);
+    is_norm = (strcmp(goal, "norm") == 0);
+    neighbours = (neighbours > 0) ? neighbours : SYMKNN_DEFAULT_NEIGHBOURS;
+
+    if (!is_ddg && !is_norm && strcmp(goal, "sym") != 0 && strcmp(goal, "symknn") != 0 &&
+        strcmp(goal, "symnmf") != 0) {
+        PyErr_SetString(PyExc_ValueError, "An Error Has Occurred");
+        return NULL;
+    }
+
+    x_array = convert_numpy_to_data(x_obj, &x_matrix);
+    if (x_array == NULL) {
+        return NULL;
+    }
+
+    if (strcmp(goal, "symnmf") == 0) {
+        if (clusters < 1 || clusters >= x_matrix.rows) {
+            PyErr_SetString(PyExc_ValueError, "An Error Has Occurred");
+            Py_DECREF(x_array);
             return NULL;
         }
 
-        /* Convert each element of Matrix struct to Python float */
-        for (j = 0; j < outputMatrix.cols; ++j) {
-            PyObject *pyValue = PyFloat_FromDouble(outputMatrix.data[i][j]);
+        options.scores = (double *)malloc((size_t)options.restarts * sizeof(double));
+        if (options.scores == NULL) {
+            Py_DECREF(x_array);
+            return PyErr_NoMemory();
+        }
 
-            if (!pyValue) {
-                /* Clean up if converting double to Python float fails */
-                Py_DECREF(pyRow);
+        Py_BEGIN_ALLOW_THREADS
+        setNumThreads(threads);
+        options.neighbours = is_sparse ? neighbours : 0;
+        options.radius = radius;
+        outputMatrix = symnmfFactor(x_matrix, clusters, options);
+        labels = (outputMatrix.data != NULL) ? clusterLabels(outputMatrix) : NULL;
+        setNumThreads(0);
+        Py_END_ALLOW_THREADS
 
-                for (k = 0; k < i; ++k) {
-                    Py_DECREF(PyList_GET_ITEM(pyOutputMatrixObj, k));
-                }
+        Py_DECREF(x_array);
 
-                Py_DECREF(pyOutputMatrixObj);
-                PyErr_SetString(PyExc_RuntimeError, "An Error Has Occurred");
-                return NULL;
-            }
+        if (outputMatrix.data == NULL) {
+            /* Either a graph without edges or a scratch file that cannot be created. */
+            free(options.scores);
+            PyErr_SetString((options.neighbours > 0 || options.radius > 0.0) ? PyExc_ValueError : PyExc_OSError,
+                            "An Error Has Occurred");
+            return NULL;
+        }
+
+        labels_obj = convert_indices_to_numpy(labels, outputMatrix.rows);
+        h_obj = convert_matrix_to_numpy(outputMatrix);
+        scores_obj = convert_vector_to_numpy(options.scores, options.restarts);
+        if (labels_obj == NULL || h_obj == NULL || scores_obj == NULL) {
+            Py_XDECREF(labels_obj);
+            Py_XDECREF(h_obj);
+            Py_XDECREF(scores_obj);
+            return NULL;
+        }
 
-            PyList_SET_ITEM(pyRow, j, pyValue);
+        return Py_BuildValue("(NNN)", labels_obj, h_obj, scores_obj);
+    }
 
+    Py_BEGIN_ALLOW_THREADS
+    setNumThreads(threads);
+    if (is_sparse) {
+        /* 'symknn' and 'sym' both give the graph itself. */
+        outputSparse = symKnn(x_matrix, neighbours, radius);
+        if (is_ddg || is_norm) {
+            sym_sparse = outputSparse;
+            ddg_matrix = ddgSparse(sym_sparse);
+            if (is_norm) {
+                outputSparse = normSparse(ddg_matrix, sym_sparse);
+                freeDiagMatrix(ddg_matrix);
+            }
+            freeSparseMatrix(sym_sparse);
+        }
+    }
+    else if (options.scratchFile != NULL) {
+        if (is_ddg) {
+            ddg_matrix = ddgTiled(x_matrix);
+        }
+        else {
+            mapped = (MappedMatrix *)malloc(sizeof(MappedMatrix));
+            failed = (mapped == NULL || symOutOfCore(x_matrix, is_norm, options.scratchFile, mapped) != 0);
+        }
+    }
+    else if (options.precision == PRECISION_SINGLE) {
+        outputSingle = symSingle(x_matrix);
+        if (is_ddg || is_norm) {
+            ddg_matrix = ddgSingle(outputSingle);
+        }
+        if (is_norm) {
+            outputSingle = normSingle(ddg_matrix, outputSingle);
+            freeDiagMatrix(ddg_matrix);
+        }
+        else if (is_ddg) {
+            freeFloatMatrix(outputSingle);
+        }
+    }
+    else if (is_ddg || is_norm) {
+        sym_matrix = sym(x_matrix);
+        ddg_matrix = ddg(sym_matrix);
+        if (is_norm) {
+            /* The similarity matrix becomes W in place. */
+            normInto(ddg_matrix, sym_matrix, sym_matrix);
+            outputMatrix = sym_matrix;
+            freeDiagMatrix(ddg_matrix);
+        }
+        else {
+            freeMatrix(sym_matrix);
         }
-        PyList_SET_ITEM(pyOutputMatrixObj, i, pyRow);
     }
+    else {
+        outputMatrix = sym(x_matrix);
+    }
+    setNumThreads(0);
+    Py_END_ALLOW_THREADS
+
+    /* Release NumPy arrays */
+    Py_DECREF(x_array);
+
+    if (is_ddg) {
+        return convert_vector_to_numpy(ddg_matrix.values, ddg_matrix.size);
+    }
+    if (is_sparse) {
+        return convert_sparse_to_numpy(outputSparse);
+    }
+    if (options.scratchFile != NULL) {
+        if (failed) {
+            free(mapped);
+            PyErr_SetString(PyExc_OSError, "An Error Has Occurred");
+            return NULL;
+        }
+
+        /* The array reads straight from the scratch mapping, which stays
+         * until the array is collected. */
+        dims[0] = dims[1] = mapped->matrix.rows;
+        strides[0] = (npy_intp)mapped->matrix.stride * sizeof(double);
+        strides[1] = sizeof(double);
 
-    return pyOutputMatrixObj;
+        return adopt_buffer(2, dims, strides, NPY_DOUBLE, mapped->matrix.data, mapped, MAPPING_CAPSULE_NAME);
+    }
+    if (options.precision == PRECISION_SINGLE) {
+        return convert_float_matrix_to_numpy(outputSingle);
+    }
+    return convert_matrix_to_numpy(outputMatrix);
 }
 
 
 /* 
- * Python wrapper function to iteratively update H matrix until convergence 
- * Input: H - initial H matrix (n x k)
- *        W - weight matrix (n x n)
- *        eps - convergence threshold. def = 0.0001
+ * Python wrapper function to cluster data points with k-means 
+ * Input: x - data matrix (n x d)
+ *        k - number of clusters, 1 <= k <= n
  *        iter - maximum number of iterations. def = 300
- * Return: PyObject* - converged H matrix (n x k) as a Python object
+ *        eps - the iterations stop once no centroid moves more than eps. def = 0.0001
+ *        seed - seed of the k-means++ initial centroids
+ *        threads - number of C worker threads; 0 uses the default
+ * Return: PyObject* - the label of every point, a 1-D array of int32
  */
-static PyObject* converge_h_c(PyObject* self, PyObject* args) {
-    Matrix h_matrix = {0}, w_matrix = {0}, result_matrix = {0};
-    PyArrayObject *h_array = NULL, *w_array = NULL;
-    PyObject *h_obj, *w_obj;
-    PyObject *pyResultObj = NULL;
-    double eps;
-    int iter;
-    
-    if (!PyArg_ParseTuple(args, "OOdi", &h_obj, &w_obj, &eps, &iter)) {
+static PyObject* kmeans_c(PyObject* self, PyObject* args, PyObject* kwargs) {
+    static char *kwlist[] = {"x", "k", "iter", "eps", "seed", "threads", NULL};
+    int clusters, iter = KMEANS_DEFAULT_ITER, threads = 0;
+    double eps = KMEANS_DEFAULT_EPS;
+    unsigned long seed = 0;
+    PyObject *x_obj;
+    PyArrayObject *x_array;
+    Matrix x_matrix;
+    int *labels;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Oi|idki", kwlist, &x_obj, &clusters, &iter, &eps, &seed,
+                                     &threads)) {
         return NULL;
     }
 
-    h_array = (PyArrayObject *)PyArray_FROM_OTF(h_obj, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY);
-    w_array = (PyArrayObject *)PyArray_FROM_OTF(w_obj, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY);
+    x_array = convert_numpy_to_data(x_obj, &x_matrix);
+    if (x_array == NULL) {
+        return NULL;
+    }
 
-    if (h_array == NULL || w_array == NULL) {
-        PyErr_SetString(PyExc_TypeError, "An Error Has Occurred");
-        Py_XDECREF(h_array);
-        Py_XDECREF(w_array);
+    if (clusters < 1 || clusters > x_matrix.rows || clusters > KMEANS_MAX_CLUSTERS || iter < 0 || eps < 0.0) {
+        Py_DECREF(x_array);
+        PyErr_SetString(PyExc_ValueError, "An Error Has Occurred");
         return NULL;
     }
 
-    h_matrix = convert_numpy_to_matrix(h_array);
-    w_matrix = convert_numpy_to_matrix(w_array);
+    Py_BEGIN_ALLOW_THREADS
+    setNumThreads(threads);
+    labels = kmeans(x_matrix, clusters, iter, eps, seed, NULL);
+    setNumThreads(0);
+    Py_END_ALLOW_THREADS
 
-    if (h_matrix.data == NULL || w_matrix.data == NULL) {
-        PyErr_SetString(PyExc_RuntimeError, "An Error Has Occurred");
-        freeMatrix(h_matrix);
-        freeMatrix(w_matrix);
-        Py_DECREF(h_array);
-        Py_DECREF(w_array);
+    Py_DECREF(x_array);
+
+    return convert_indices_to_numpy(labels, x_matrix.rows);
+}
+
+
+/* 
+ * Python wrapper function to compute silhouette scores 
+ * Input: labels - one labeling (1-D, n non-negative integers) or several
+ *                 (a 2-D array or a sequence of 1-D ones), all scored in
+ *                 one pass over the distances
+ *        x - data points (n x d)
+ *        A - similarity matrix of x (n x n), as from symnmf_c('sym', x);
+ *            the distances are recovered from it instead of computed from x
+ *        distances - Euclidean distances of the points (n x n), used as they
+ *                    are; x is then not needed
+ *        threads - number of C worker threads; 0 uses the default
+ * Return: PyObject* - the silhouette score, a float for one labeling or a
+ *         1-D array of float64 for several
+ */
+static PyObject* silhouette_c(PyObject* self, PyObject* args, PyObject* kwargs) {
+    static char *kwlist[] = {"labels", "x", "A", "distances", "threads", NULL};
+    PyObject *labels_obj, *x_obj = Py_None, *a_obj = Py_None, *distances_obj = Py_None;
+    PyArrayObject *labels_array, *x_array = NULL, *a_array = NULL, *distances_array = NULL;
+    PairwiseDistances pairs;
+    double *scores;
+    const int *labels;
+    int threads = 0;
+    int single, count, n, i, failed;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|OOOi", kwlist, &labels_obj, &x_obj, &a_obj, &distances_obj,
+                                     &threads)) {
         return NULL;
     }
 
-    result_matrix = converge_H(h_matrix, w_matrix, eps, iter);
+    labels_array = (PyArrayObject *)PyArray_FROM_OTF(labels_obj, NPY_INT, NPY_ARRAY_IN_ARRAY | NPY_ARRAY_FORCECAST);
+    if (labels_array == NULL) {
+        return NULL;
+    }
 
-    if (result_matrix.data == NULL) {
-        PyErr_SetString(PyExc_RuntimeError, "An Error Has Occurred");
-        freeMatrix(h_matrix);
-        freeMatrix(w_matrix);
-        Py_DECREF(h_array);
-        Py_DECREF(w_array);
+    /* Only a 1-D or 2-D array has the dimensions read below. */
+    if (PyArray_NDIM(labels_array) != 1 && PyArray_NDIM(labels_array) != 2) {
+        Py_DECREF(labels_array);
+        PyErr_SetString(PyExc_ValueError, "An Error Has Occurred");
         return NULL;
     }
 
-    pyResultObj = convert_matrix_to_python(result_matrix);
+    memset(&pairs, 0, sizeof(pairs));
+    if (distances_obj != Py_None) {
+        distances_array = convert_numpy_to_matrix(distances_obj, &pairs.distances);
+        failed = (distances_array == NULL);
+    }
+    else {
+        x_array = (x_obj != Py_None) ? convert_numpy_to_data(x_obj, &pairs.X) : NULL;
+        a_array = (x_array != NULL && a_obj != Py_None) ? convert_numpy_to_matrix(a_obj, &pairs.A) : NULL;
+        failed = (x_array == NULL || (a_obj != Py_None && a_array == NULL));
+    }
+
+    single = (PyArray_NDIM(labels_array) == 1);
+    count = single ? 1 : (int)PyArray_DIM(labels_array, 0);
+    n = (int)PyArray_DIM(labels_array, single ? 0 : 1);
+    labels = (const int *)PyArray_DATA(labels_array);
 
-    freeMatrix(h_matrix);
-    freeMatrix(w_matrix);
-    freeMatrix(result_matrix);
+    if (!failed) {
+        failed = (count < 1 || n < 1 ||
+                  (distances_array != NULL && (pairs.distances.rows != n || pairs.distances.cols != n)) ||
+                  (x_array != NULL && pairs.X.rows != n) ||
+                  (a_array != NULL && (pairs.A.rows != n || pairs.A.cols != n)));
+        for (i = 0; !failed && i < count * n; i++) {
+            failed = (labels[i] < 0 || labels[i] >= n);
+        }
+        if (failed) {
+            PyErr_SetString(PyExc_ValueError, "An Error Has Occurred");
+        }
+    }
 
-    /* Release NumPy arrays*/
-    Py_DECREF(h_array);
-    Py_DECREF(w_array);
+    scores = failed ? NULL : (double *)malloc((size_t)count * sizeof(double));
+    if (!failed && scores == NULL) {
+        PyErr_NoMemory();
+        failed = 1;
+    }
 
-    if (pyResultObj == NULL) {
-        PyErr_SetString(PyExc_RuntimeError, "An Error Has Occurred");
+    if (!failed) {
+        Py_BEGIN_ALLOW_THREADS
+        setNumThreads(threads);
+        silhouetteScores(pairs, labels, count, scores);
+        setNumThreads(0);
+        Py_END_ALLOW_THREADS
     }
 
-    return pyResultObj;
+    Py_DECREF(labels_array);
+    Py_XDECREF(x_array);
+    Py_XDECREF(a_array);
+    Py_XDECREF(distances_array);
+
+    if (failed) {
+        /* A missing x, or an array that does not convert; the conversions set their own errors. */
+        if (!PyErr_Occurred()) {
+            PyErr_SetString(PyExc_ValueError, "An Error Has Occurred");
+        }
+        return NULL;
+    }
+    if (single) {
+        PyObject *score = PyFloat_FromDouble(scores[0]);
+        free(scores);
+        return score;
+    }
+    return convert_vector_to_numpy(scores, count);
 }
 
 
 /* 
- * Python wrapper function for SymNMF operations 
- * Input: goal - the desired operation ('sym', 'ddg', 'norm')
- *        x - data matrix
- * Return: PyObject* - resulting matrix as a Python object
+ * Python wrapper function to estimate the peak memory of a symnmf_c('symnmf') call 
+ * Input: n, d - size of the data matrix
+ *        k - number of clusters
+ *        knn, radius, precision, scratch, weights, solver, stop, restarts,
+ *        threads - as for symnmf_c
+ * Return: PyObject* - the peak bytes, an int; see symnmfFootprint
  */
-static PyObject* symnmf_c(PyObject* self, PyObject* args) {
-    char *goal;
-    PyObject *x_obj;
-    PyArrayObject *x_array;
-    PyObject *pyOutputMatrixObj;
-    Matrix outputMatrix, x_matrix;
-    Matrix sym_matrix;
+static PyObject* symnmf_footprint(PyObject* self, PyObject* args, PyObject* kwargs) {
+    static char *kwlist[] = {"n", "d", "k", "knn", "radius", "precision", "scratch", "weights", "solver", "stop",
+                             "restarts", "threads", NULL};
+    char *precision_name = "double";
+    char *weights_name = "dense";
+    const char *solver = "multiplicative";
+    const char *stop = "change";
+    SymnmfOptions options = defaultSymnmfOptions();
+    int n, d, clusters, threads = 0;
+    size_t bytes;
 
-    if (!PyArg_ParseTuple(args, "sO", &goal, &x_obj)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "iii|idszsssii", kwlist, &n, &d, &clusters,
+                                     &options.neighbours, &options.radius, &precision_name, &options.scratchFile,
+                                     &weights_name, &solver, &stop, &options.restarts, &threads)) {
         return NULL;
     }
 
-    x_array = (PyArrayObject *)PyArray_FROM_OTF(x_obj, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY);
-    if (x_array == NULL) {
-        PyErr_SetString(PyExc_TypeError, "An Error Has Occurred");
+    if (convert_solver_options(solver, stop, options.solver.beta, options.solver.patience, &options.solver) != 0) {
+        return NULL;
+    }
+    if (n < 2 || d < 1 || clusters < 1 || clusters >= n || options.restarts < 1 ||
+        (strcmp(precision_name, "double") != 0 && strcmp(precision_name, "single") != 0) ||
+        (strcmp(weights_name, "dense") != 0 && strcmp(weights_name, "implicit") != 0)) {
+        PyErr_SetString(PyExc_ValueError, "An Error Has Occurred");
         return NULL;
     }
+    options.precision = (strcmp(precision_name, "single") == 0) ? PRECISION_SINGLE : PRECISION_DOUBLE;
+    options.implicit = (strcmp(weights_name, "implicit") == 0);
 
-    x_matrix = convert_numpy_to_matrix(x_array);
+    setNumThreads(threads);
+    bytes = symnmfFootprint(n, d, clusters, options);
+    setNumThreads(0);
 
-    if (strcmp(goal, "sym") == 0) {
-        outputMatrix = sym(x_matrix);
+    return PyLong_FromSize_t(bytes);
+}
+
+
+/* 
+ * Python wrapper function to read the matrix allocation counters
+ * Input: reset - if true, restart the counters from zero after reading them
+ * Return: PyObject* - (count, bytes) of matrix allocations since the last reset
+ */
+static PyObject* allocation_stats(PyObject* self, PyObject* args, PyObject* kwargs) {
+    static char *keywords[] = {"reset", NULL};
+    int reset = 0;
+    long count, bytes;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|p", keywords, &reset)) {
+        return NULL;
     }
-    else if (strcmp(goal, "ddg") == 0) {
-        sym_matrix = sym(x_matrix);
-        outputMatrix = ddg(sym_matrix);
-        freeMatrix(sym_matrix);
-    } 
-    else if (strcmp(goal, "norm") == 0) {
-        sym_matrix = sym(x_matrix);
-        outputMatrix = norm(ddg(sym_matrix), sym_matrix);
-        freeMatrix(sym_matrix);
-    } 
-    else {
+
+    allocationStats(&count, &bytes);
+    if (reset) {
+        resetAllocationStats();
+    }
+    return Py_BuildValue("(ll)", count, bytes);
+}
+
+
+/* 
+ * Python wrapper function to read data points as the symnmf binary does 
+ * Input: file_name - path of a comma separated text file, or of a binary
+ *                    matrix file
+ * Return: PyObject* - the points as a 2-D NumPy array of float64
+ */
+static PyObject* load_data_c(PyObject* self, PyObject* args) {
+    const char *file_name;
+    Matrix x_matrix;
+    int failed;
+
+    if (!PyArg_ParseTuple(args, "s", &file_name)) {
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    failed = readDataFile(file_name, &x_matrix);
+    Py_END_ALLOW_THREADS
+
+    if (failed) {
         PyErr_SetString(PyExc_ValueError, "An Error Has Occurred");
-        freeMatrix(x_matrix);
-        Py_DECREF(x_array);
         return NULL;
     }
 
-    pyOutputMatrixObj = convert_matrix_to_python(outputMatrix);
+    return convert_matrix_to_numpy(x_matrix);
+}
 
-    freeMatrix(x_matrix);
-    freeMatrix(outputMatrix);
 
-    /* Release NumPy arrays */
-    Py_DECREF(x_array);
+/* 
+ * Python wrapper function to read a binary matrix file 
+ * Input: file_name - path of a file written by save_matrix_c or symnmf --output
+ * Return: PyObject* - the matrix as a 2-D NumPy array of float64
+ */
+static PyObject* load_matrix_c(PyObject* self, PyObject* args) {
+    const char *file_name;
+    MappedMatrix *mapped = NULL;
+    npy_intp dims[2], strides[2];
+
+    if (!PyArg_ParseTuple(args, "s", &file_name)) {
+        return NULL;
+    }
+
+    mapped = (MappedMatrix *)malloc(sizeof(MappedMatrix));
+    if (mapped == NULL) {
+        return PyErr_NoMemory();
+    }
+
+    if (mapMatrixFile(file_name, mapped) != 0) {
+        free(mapped);
+        PyErr_SetString(PyExc_ValueError, "An Error Has Occurred");
+        return NULL;
+    }
+
+    /* The array reads straight from the (copy-on-write) mapping, which stays
+     * open until the array is collected. */
+    dims[0] = mapped->matrix.rows;
+    dims[1] = mapped->matrix.cols;
+    strides[0] = (npy_intp)mapped->matrix.stride * sizeof(double);
+    strides[1] = sizeof(double);
+
+    return adopt_buffer(2, dims, strides, NPY_DOUBLE, mapped->matrix.data, mapped, MAPPING_CAPSULE_NAME);
+}
+
+
+/* 
+ * Python wrapper function to write a binary matrix file 
+ * Input: file_name - path of the file to create or overwrite
+ *        matrix - 2-D array-like of numbers; 1-D input is written as a column
+ * Return: None
+ */
+static PyObject* save_matrix_c(PyObject* self, PyObject* args) {
+    const char *file_name;
+    PyObject *matrix_obj;
+    PyArrayObject *array;
+    Matrix view;
+    int failed;
+
+    if (!PyArg_ParseTuple(args, "sO", &file_name, &matrix_obj)) {
+        return NULL;
+    }
+
+    array = (PyArrayObject *)PyArray_FROM_OTF(matrix_obj, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY);
+    if (array == NULL || PyArray_NDIM(array) < 1 || PyArray_NDIM(array) > 2) {
+        PyErr_SetString(PyExc_TypeError, "An Error Has Occurred");
+        Py_XDECREF(array);
+        return NULL;
+    }
 
-    return pyOutputMatrixObj;
+    /* A C-contiguous array is already laid out like a Matrix with stride == cols. */
+    view.rows = (int)PyArray_DIM(array, 0);
+    view.cols = (PyArray_NDIM(array) == 2) ? (int)PyArray_DIM(array, 1) : 1;
+    view.stride = view.cols;
+    view.data = (double *)PyArray_DATA(array);
+    view.block = NULL;
+
+    failed = saveMatrixFile(file_name, view);
+    Py_DECREF(array);
+
+    if (failed) {
+        PyErr_SetString(PyExc_OSError, "An Error Has Occurred");
+        return NULL;
+    }
+
+    Py_RETURN_NONE;
 }
 
 
 /* Methods definitions for the Python module: */
 static PyMethodDef methods[] = {
-    {"symnmf_c", (PyCFunction)symnmf_c, METH_VARARGS, "C implementation of symmetric non-negative matrix factorization."},
-    {"converge_h_c", (PyCFunction)converge_h_c, METH_VARARGS, "Converge H using C implementation."},
+    {"symnmf_c", (PyCFunction)(void (*)(void))symnmf_c, METH_VARARGS | METH_KEYWORDS, "C implementation of symmetric non-negative matrix factorization."},
+    {"converge_h_c", (PyCFunction)(void (*)(void))converge_h_c, METH_VARARGS | METH_KEYWORDS, "Converge H using C implementation."},
+    {"converge_h_restarts", (PyCFunction)(void (*)(void))converge_h_restarts, METH_VARARGS | METH_KEYWORDS, "Converge several initial H against one W; returns (best H, scores)."},
+    {"extend_symnmf_c", (PyCFunction)(void (*)(void))extend_symnmf_c, METH_VARARGS | METH_KEYWORDS, "Add data points to a factorization; returns (X, A, D, H)."},
+    {"converge_h_async", (PyCFunction)(void (*)(void))converge_h_async, METH_VARARGS | METH_KEYWORDS, "Start converging H on a background thread; returns a future."},
+    {"kmeans_c", (PyCFunction)(void (*)(void))kmeans_c, METH_VARARGS | METH_KEYWORDS, "Cluster data points with k-means (k-means++ seeding); returns the labels."},
+    {"silhouette_c", (PyCFunction)(void (*)(void))silhouette_c, METH_VARARGS | METH_KEYWORDS, "Silhouette scores of one or several labelings, in one pass over the distances."},
+    {"symnmf_footprint", (PyCFunction)(void (*)(void))symnmf_footprint, METH_VARARGS | METH_KEYWORDS, "Estimate the peak bytes of symnmf_c('symnmf') for an n x d input."},
+    {"allocation_stats", (PyCFunction)(void (*)(void))allocation_stats, METH_VARARGS | METH_KEYWORDS, "Return (count, bytes) of matrix allocations; allocation_stats(reset=False)."},
+    {"load_data_c", (PyCFunction)load_data_c, METH_VARARGS, "Read data points from a text or binary matrix file."},
+    {"load_matrix_c", (PyCFunction)load_matrix_c, METH_VARARGS, "Read a binary matrix file into a NumPy array."},
+    {"save_matrix_c", (PyCFunction)save_matrix_c, METH_VARARGS, "Write a matrix to a binary matrix file."},
     {NULL, NULL, 0, NULL}
 };
 
@@ -254,6 +1786,32 @@ static struct PyModuleDef symnmfmodule = {
 };
 
 PyMODINIT_FUNC PyInit_mysymnmf(void) {
+    PyObject *module;
+
     import_array(); /* For NumPy */
-    return PyModule_Create(&symnmfmodule);
+
+    ConvergeFutureType.tp_name = "mysymnmf.ConvergeFuture";
+    ConvergeFutureType.tp_doc = "A converge_H call running on a background thread.";
+    ConvergeFutureType.tp_basicsize = sizeof(ConvergeFuture);
+    ConvergeFutureType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ConvergeFutureType.tp_dealloc = (destructor)converge_future_dealloc;
+    ConvergeFutureType.tp_methods = converge_future_methods;
+    ConvergeFutureType.tp_getset = converge_future_getset;
+    if (PyType_Ready(&ConvergeFutureType) < 0) {
+        return NULL;
+    }
+
+    module = PyModule_Create(&symnmfmodule);
+    if (module == NULL) {
+        return NULL;
+    }
+
+    Py_INCREF(&ConvergeFutureType);
+    if (PyModule_AddObject(module, "ConvergeFuture", (PyObject *)&ConvergeFutureType) < 0) {
+        Py_DECREF(&ConvergeFutureType);
+        Py_DECREF(module);
+        return NULL;
+    }
+
+    return module;
 }